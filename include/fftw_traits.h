@@ -0,0 +1,131 @@
+#ifndef FFTW_TRAITS_H
+#define FFTW_TRAITS_H
+
+#include "general.h"
+
+// Maps the scalar type of the solver fields to the matching FFTW library (fftw_* for double, fftwf_* for float)
+// and MPI datatype, so that the solver can be written once for both precisions.
+template <typename real_t>
+struct FFTWTraits;
+
+// Planner flags for the "fftw_planner" input option, see https://fftw.org/doc/Planner-Flags.html
+inline unsigned fftwPlannerFlags(const string &planner)
+{
+    if (planner == "estimate") {
+        return FFTW_ESTIMATE;
+    } else if (planner == "measure") {
+        return FFTW_MEASURE;
+    } else if (planner == "patient") {
+        return FFTW_PATIENT;
+    } else if (planner == "wisdom_only") {
+        return FFTW_WISDOM_ONLY;
+    } else {
+        throw std::invalid_argument(planner + " is not a valid fftw_planner");
+    }
+}
+
+template <>
+struct FFTWTraits<double> {
+    typedef fftw_plan    plan;
+    typedef fftw_complex complex;
+
+    static MPI_Datatype mpi_type()
+    {
+        return MPI_DOUBLE;
+    }
+    static double *alloc_real(size_t n)
+    {
+        return fftw_alloc_real(n);
+    }
+    static plan mpi_plan_many_dft_r2c(int rank, const ptrdiff_t *n, ptrdiff_t howmany, ptrdiff_t iblock, ptrdiff_t oblock, double *in, complex *out, MPI_Comm comm, unsigned flags)
+    {
+        return fftw_mpi_plan_many_dft_r2c(rank, n, howmany, iblock, oblock, in, out, comm, flags);
+    }
+    static plan mpi_plan_many_dft_c2r(int rank, const ptrdiff_t *n, ptrdiff_t howmany, ptrdiff_t iblock, ptrdiff_t oblock, complex *in, double *out, MPI_Comm comm, unsigned flags)
+    {
+        return fftw_mpi_plan_many_dft_c2r(rank, n, howmany, iblock, oblock, in, out, comm, flags);
+    }
+    static void execute(const plan p)
+    {
+        fftw_execute(p);
+    }
+    static void destroy_plan(plan p)
+    {
+        fftw_destroy_plan(p);
+    }
+    static void free(void *p)
+    {
+        fftw_free(p);
+    }
+    static int import_wisdom_from_filename(const char *filename)
+    {
+        return fftw_import_wisdom_from_filename(filename);
+    }
+    static int export_wisdom_to_filename(const char *filename)
+    {
+        return fftw_export_wisdom_to_filename(filename);
+    }
+    static void mpi_broadcast_wisdom(MPI_Comm comm)
+    {
+        fftw_mpi_broadcast_wisdom(comm);
+    }
+    static void mpi_gather_wisdom(MPI_Comm comm)
+    {
+        fftw_mpi_gather_wisdom(comm);
+    }
+};
+
+#ifdef FANS_SINGLE_PRECISION
+template <>
+struct FFTWTraits<float> {
+    typedef fftwf_plan    plan;
+    typedef fftwf_complex complex;
+
+    static MPI_Datatype mpi_type()
+    {
+        return MPI_FLOAT;
+    }
+    static float *alloc_real(size_t n)
+    {
+        return fftwf_alloc_real(n);
+    }
+    static plan mpi_plan_many_dft_r2c(int rank, const ptrdiff_t *n, ptrdiff_t howmany, ptrdiff_t iblock, ptrdiff_t oblock, float *in, complex *out, MPI_Comm comm, unsigned flags)
+    {
+        return fftwf_mpi_plan_many_dft_r2c(rank, n, howmany, iblock, oblock, in, out, comm, flags);
+    }
+    static plan mpi_plan_many_dft_c2r(int rank, const ptrdiff_t *n, ptrdiff_t howmany, ptrdiff_t iblock, ptrdiff_t oblock, complex *in, float *out, MPI_Comm comm, unsigned flags)
+    {
+        return fftwf_mpi_plan_many_dft_c2r(rank, n, howmany, iblock, oblock, in, out, comm, flags);
+    }
+    static void execute(const plan p)
+    {
+        fftwf_execute(p);
+    }
+    static void destroy_plan(plan p)
+    {
+        fftwf_destroy_plan(p);
+    }
+    static void free(void *p)
+    {
+        fftwf_free(p);
+    }
+    static int import_wisdom_from_filename(const char *filename)
+    {
+        return fftwf_import_wisdom_from_filename(filename);
+    }
+    static int export_wisdom_to_filename(const char *filename)
+    {
+        return fftwf_export_wisdom_to_filename(filename);
+    }
+    static void mpi_broadcast_wisdom(MPI_Comm comm)
+    {
+        fftwf_mpi_broadcast_wisdom(comm);
+    }
+    static void mpi_gather_wisdom(MPI_Comm comm)
+    {
+        fftwf_mpi_gather_wisdom(comm);
+    }
+};
+#endif
+
+#endif
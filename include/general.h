@@ -35,6 +35,28 @@ using namespace Eigen;
 #include "mpi.h"
 #include "sys/stat.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Number of threads of the next parallel region and index of the calling thread, 1 and 0 without OpenMP
+inline int maxThreads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+inline int threadIndex()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
 #endif
 
 #ifndef FANS_MALLOC_H
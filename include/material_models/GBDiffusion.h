@@ -106,9 +106,8 @@ class GBDiffusion : public ThermalModel, public LinearModel<1> {
                 phase_kappa = D_bulk[i] * Matrix3d::Identity();
             } else if (i < n_mat) {
                 // Grain boundary is transversely isotropic
-                N           = Vector3d(GBnormals[3 * i + 0], GBnormals[3 * i + 1], GBnormals[3 * i + 2]);
-                N           = N.normalized();
-                phase_kappa = D_par[i] * (Matrix3d::Identity() - N * N.transpose()) + D_perp[i] * N * N.transpose();
+                const Vector3d N = Vector3d(GBnormals[3 * i + 0], GBnormals[3 * i + 1], GBnormals[3 * i + 2]).normalized();
+                phase_kappa      = D_par[i] * (Matrix3d::Identity() - N * N.transpose()) + D_perp[i] * N * N.transpose();
             } else {
                 throw std::runtime_error("GBDiffusion: Unknown material index");
             }
@@ -126,10 +125,14 @@ class GBDiffusion : public ThermalModel, public LinearModel<1> {
         phase_stiffness = nullptr;
     }
 
-    void get_sigma(int i, int mat_index, ptrdiff_t element_idx) override
+    void get_sigma(const double *strain, double *stress, int n_points, int mat_index, ptrdiff_t first_point) override
     {
         if (mat_index < num_crystals) {
-            sigma.block<3, 1>(i, 0) = D_bulk[mat_index] * eps.block<3, 1>(i, 0);
+            const double d = D_bulk[mat_index];
+#pragma omp simd
+            for (int j = 0; j < 3 * n_points; ++j) {
+                stress[j] = d * strain[j];
+            }
         } else if (mat_index < n_mat) {
             const ptrdiff_t base_idx = 3 * mat_index;
             double          nx       = GBnormals[base_idx];
@@ -145,43 +148,38 @@ class GBDiffusion : public ThermalModel, public LinearModel<1> {
             double nznz = nz * nz;
 
             // Pre-compute coefficients
+            double d_par  = D_par[mat_index];
             double d_diff = D_par[mat_index] - D_perp[mat_index];
 
-            // Cache epsilon values to avoid repeated memory access
-            double ex = eps(i, 0);
-            double ey = eps(i + 1, 0);
-            double ez = eps(i + 2, 0);
-
             // Calculate directly without constructing full matrices
-            sigma(i, 0)     = D_par[mat_index] * ex - d_diff * (nxnx * ex + nxny * ey + nxnz * ez);
-            sigma(i + 1, 0) = D_par[mat_index] * ey - d_diff * (nxny * ex + nyny * ey + nynz * ez);
-            sigma(i + 2, 0) = D_par[mat_index] * ez - d_diff * (nxnz * ex + nynz * ey + nznz * ez);
+#pragma omp simd
+            for (int p = 0; p < n_points; ++p) {
+                const double ex   = strain[3 * p];
+                const double ey   = strain[3 * p + 1];
+                const double ez   = strain[3 * p + 2];
+                stress[3 * p]     = d_par * ex - d_diff * (nxnx * ex + nxny * ey + nxnz * ez);
+                stress[3 * p + 1] = d_par * ey - d_diff * (nxny * ex + nyny * ey + nynz * ez);
+                stress[3 * p + 2] = d_par * ez - d_diff * (nxnz * ex + nynz * ey + nznz * ez);
+            }
         } else {
             throw std::runtime_error("GBDiffusion: Unknown material index");
         }
     }
 
-    void postprocess(Solver<1> &solver, Reader &reader, const char *resultsFileName, int load_idx, int time_idx) override
+    void postprocess(Reader &reader, const char *resultsFileName, int load_idx, int time_idx) override
     {
         // Write GBnormals to HDF5 file if requested
         if (find(reader.resultsToWrite.begin(), reader.resultsToWrite.end(), "GBnormals") != reader.resultsToWrite.end()) {
-            double *GBnormals_field = FANS_malloc<double>(solver.local_n0 * solver.n_y * solver.n_z * 3);
-            for (ptrdiff_t element_idx = 0; element_idx < solver.local_n0 * solver.n_y * solver.n_z; ++element_idx) {
-                int mat_index = solver.ms[element_idx];
+            double *GBnormals_field = FANS_malloc<double>(reader.local_n0 * reader.dims[1] * reader.dims[2] * 3);
+            for (ptrdiff_t element_idx = 0; element_idx < reader.local_n0 * reader.dims[1] * reader.dims[2]; ++element_idx) {
+                int mat_index = reader.ms[element_idx];
                 if (mat_index >= num_crystals) {
                     GBnormals_field[element_idx * 3]     = GBnormals[3 * mat_index];
                     GBnormals_field[element_idx * 3 + 1] = GBnormals[3 * mat_index + 1];
                     GBnormals_field[element_idx * 3 + 2] = GBnormals[3 * mat_index + 2];
                 }
             }
-            for (int i = 0; i < solver.world_size; ++i) {
-                if (i == solver.world_rank) {
-                    char name[5096];
-                    sprintf(name, "%s/load%i/time_step%i/GBnormals", reader.ms_datasetname, load_idx, time_idx);
-                    reader.WriteSlab<double>(GBnormals_field, 3, resultsFileName, name);
-                }
-                MPI_Barrier(MPI_COMM_WORLD);
-            }
+            reader.WriteResultSlab<double>(GBnormals_field, 3, resultsFileName, load_idx, time_idx, "GBnormals");
             FANS_free(GBnormals_field);
         }
     }
@@ -195,8 +193,7 @@ class GBDiffusion : public ThermalModel, public LinearModel<1> {
     vector<double> D_par;
     vector<double> D_perp;
 
-    double  *GBnormals = nullptr;
-    Vector3d N;
+    double *GBnormals = nullptr;
 };
 
 #endif // GBDIFFUSION_H
@@ -2,7 +2,6 @@
 #define J2PLASTICITY_H
 
 #include "matmodel.h"
-#include "solver.h"
 
 class J2Plasticity : public MechModel {
   public:
@@ -34,14 +33,12 @@ class J2Plasticity : public MechModel {
         }
         kapparef_mat /= n_mat;
 
-        // Allocate the member matrices/vectors for performance optimization
         sqrt_two_over_three = sqrt(2.0 / 3.0);
-        sigma_trial_n1.setZero();
-        dev.setZero();
-        qbar_trial_n1.setZero();
-        n.setZero();
-        eps_elastic.setZero();
-        dev_minus_qbar.setZero();
+    }
+
+    ~J2Plasticity()
+    {
+        free_internal_variables();
     }
 
     /**
@@ -55,72 +52,200 @@ class J2Plasticity : public MechModel {
      * @param num_gauss_points The number of Gauss points per element.
      *
      * @note Variables with the suffix '_t' represent values from the previous time step.
+     * @note The variables are stored contiguously, element by element and Gauss point by Gauss point
+     *       (6 components per Gauss point for the plastic strain and the back strain psi_bar).
      */
     virtual void initializeInternalVariables(ptrdiff_t num_elements, int num_gauss_points) override
     {
-        // Initialize plastic strain and other internal variables
-        plasticStrain.resize(num_elements, Matrix<double, 6, Dynamic>::Zero(6, num_gauss_points));
-        plasticStrain_t.resize(num_elements, Matrix<double, 6, Dynamic>::Zero(6, num_gauss_points));
-        psi.resize(num_elements, VectorXd::Zero(num_gauss_points));
-        psi_t.resize(num_elements, VectorXd::Zero(num_gauss_points));
-        psi_bar.resize(num_elements, Matrix<double, 6, Dynamic>::Zero(6, num_gauss_points));
-        psi_bar_t.resize(num_elements, Matrix<double, 6, Dynamic>::Zero(6, num_gauss_points));
+        // The buffers are kept when the solver is reused with the same grid, they are only reset
+        const size_t n_points = static_cast<size_t>(num_elements) * num_gauss_points;
+        if (n_points != num_points) {
+            free_internal_variables();
+            num_points      = n_points;
+            plasticStrain   = FANS_malloc<double>(6 * num_points);
+            plasticStrain_t = FANS_malloc<double>(6 * num_points);
+            psi             = FANS_malloc<double>(num_points);
+            psi_t           = FANS_malloc<double>(num_points);
+            psi_bar         = FANS_malloc<double>(6 * num_points);
+            psi_bar_t       = FANS_malloc<double>(6 * num_points);
+        }
+        n_gp = num_gauss_points;
+        std::fill_n(plasticStrain, 6 * num_points, 0.0);
+        std::fill_n(plasticStrain_t, 6 * num_points, 0.0);
+        std::fill_n(psi, num_points, 0.0);
+        std::fill_n(psi_t, num_points, 0.0);
+        std::fill_n(psi_bar, 6 * num_points, 0.0);
+        std::fill_n(psi_bar_t, 6 * num_points, 0.0);
     }
 
+    // The converged state becomes the history, get_sigma overwrites the current state from the history in every
+    // evaluation, so the buffers are swapped instead of copied
     virtual void updateInternalVariables() override
     {
-        plasticStrain_t = plasticStrain;
-        psi_t           = psi;
-        psi_bar_t       = psi_bar;
+        std::swap(plasticStrain_t, plasticStrain);
+        std::swap(psi_t, psi);
+        std::swap(psi_bar_t, psi_bar);
     }
 
-    void get_sigma(int i, int mat_index, ptrdiff_t element_idx) override
+    // Radial return mapping for a batch of points, in chunks of batch_size points stored component-wise. The elastic
+    // predictor and the update are branch-free loops over the points, the hardening law is evaluated per chunk.
+    void get_sigma(const double *strain, double *stress, int n_points, int mat_index, ptrdiff_t first_point) override
     {
-        // Elastic Predictor
-        eps_elastic = eps.block<6, 1>(i, 0) - plasticStrain_t[element_idx].col(i / n_str);
-        treps       = eps_elastic.head<3>().sum();
-
-        // Compute trial stress
-        sigma_trial_n1.head<3>().setConstant(bulk_modulus[mat_index] * treps);
-        sigma_trial_n1.head<3>() += 2 * shear_modulus[mat_index] * eps_elastic.head<3>();
-        sigma_trial_n1.tail<3>() = 2 * shear_modulus[mat_index] * eps_elastic.tail<3>();
-
-        // Deviatoric stress and norm
-        dev = sigma_trial_n1;
-        dev.head<3>().array() -= sigma_trial_n1.head<3>().mean();
-
-        // Compute trial q and q_bar
-        q_trial_n1              = compute_q_trial(psi_t[element_idx](i / n_str), mat_index);
-        qbar_trial_n1.head<3>() = -H[mat_index] * (2.0 / 3.0) * psi_bar_t[element_idx].col(i / n_str).head<3>();
-        qbar_trial_n1.tail<3>().setZero(); // Lower part is zero
-
-        // Calculate the trial yield function
-        dev_minus_qbar      = dev - qbar_trial_n1;
-        norm_dev_minus_qbar = dev_minus_qbar.norm();
-
-        // Avoid division by zero
-        n = (norm_dev_minus_qbar < 1e-12) ? n.setZero() : dev_minus_qbar / norm_dev_minus_qbar;
+        const double bulk        = bulk_modulus[mat_index];
+        const double two_mu      = 2 * shear_modulus[mat_index];
+        const double kinematic   = -H[mat_index] * (2.0 / 3.0);
+        const double sigma_yield = yield_stress[mat_index];
+
+        alignas(64) double sigma_trial[6][batch_size];
+        alignas(64) double n[6][batch_size];
+        alignas(64) double norm_dev_minus_qbar[batch_size];
+        alignas(64) double q_trial[batch_size];
+        alignas(64) double f_trial[batch_size];
+        alignas(64) double gamma[batch_size];
+
+        for (int p0 = 0; p0 < n_points; p0 += batch_size) {
+            const int       nb     = std::min(batch_size, n_points - p0);
+            const ptrdiff_t point0 = first_point + p0;
+
+            // Elastic predictor and trial yield function
+#pragma omp simd
+            for (int p = 0; p < nb; ++p) {
+                const double *e   = strain + 6 * (p0 + p);
+                const double *ep  = plasticStrain_t + 6 * (point0 + p);
+                const double *pb  = psi_bar_t + 6 * (point0 + p);
+                double        eps_elastic[6], dev_minus_qbar[6];
+                for (int j = 0; j < 6; ++j)
+                    eps_elastic[j] = e[j] - ep[j];
+                const double treps = eps_elastic[0] + eps_elastic[1] + eps_elastic[2];
+
+                for (int j = 0; j < 3; ++j) {
+                    sigma_trial[j][p]     = bulk * treps + two_mu * eps_elastic[j];
+                    sigma_trial[j + 3][p] = two_mu * eps_elastic[j + 3];
+                }
+                const double mean = (sigma_trial[0][p] + sigma_trial[1][p] + sigma_trial[2][p]) / 3.0;
+                double       norm = 0.0;
+                for (int j = 0; j < 3; ++j) {
+                    dev_minus_qbar[j]     = sigma_trial[j][p] - mean - kinematic * pb[j];
+                    dev_minus_qbar[j + 3] = sigma_trial[j + 3][p];
+                }
+                for (int j = 0; j < 6; ++j)
+                    norm += dev_minus_qbar[j] * dev_minus_qbar[j];
+                norm                   = sqrt(norm);
+                norm_dev_minus_qbar[p] = norm;
+
+                // Avoid division by zero
+                for (int j = 0; j < 6; ++j)
+                    n[j][p] = (norm < 1e-12) ? 0.0 : dev_minus_qbar[j] / norm;
+            }
 
-        f_trial = norm_dev_minus_qbar - sqrt_two_over_three * (yield_stress[mat_index] - q_trial_n1);
+            compute_q_trial(psi_t + point0, q_trial, nb, mat_index);
+#pragma omp simd
+            for (int p = 0; p < nb; ++p)
+                f_trial[p] = norm_dev_minus_qbar[p] - sqrt_two_over_three * (sigma_yield - q_trial[p]);
+
+            // Plastic multiplier, zero for elastic points
+            compute_gamma(f_trial, psi_t + point0, gamma, nb, mat_index);
+
+            // Update stress and internal variables
+#pragma omp simd
+            for (int p = 0; p < nb; ++p) {
+                double       *s   = stress + 6 * (p0 + p);
+                double       *ep  = plasticStrain + 6 * (point0 + p);
+                const double *ept = plasticStrain_t + 6 * (point0 + p);
+                double       *pb  = psi_bar + 6 * (point0 + p);
+                const double *pbt = psi_bar_t + 6 * (point0 + p);
+                for (int j = 0; j < 6; ++j) {
+                    s[j]  = sigma_trial[j][p] - gamma[p] * two_mu * n[j][p];
+                    ep[j] = ept[j] + gamma[p] * n[j][p];
+                    pb[j] = pbt[j] - gamma[p] * n[j][p];
+                }
+                psi[point0 + p] = psi_t[point0 + p] + gamma[p] * sqrt_two_over_three;
+            }
+        }
+    }
 
-        // Compute plastic multiplier
-        gamma_n1 = (f_trial < 0) ? 0 : compute_gamma(f_trial, mat_index, i, element_idx);
+    bool has_tangent() const override
+    {
+        return true;
+    }
 
-        // Update stress and internal variables
-        sigma_trial_n1 -= gamma_n1 * 2 * shear_modulus[mat_index] * n;
-        plasticStrain[element_idx].col(i / n_str) = plasticStrain_t[element_idx].col(i / n_str) + gamma_n1 * n;
-        psi[element_idx](i / n_str) += gamma_n1 * sqrt_two_over_three;
-        psi_bar[element_idx].col(i / n_str) -= gamma_n1 * n;
+    // Consistent tangent of the radial return mapping with n = dev_minus_qbar / |dev_minus_qbar|:
+    //   C_t = C - 4 mu^2 dgamma/df_trial n (x) n - 4 mu^2 gamma / |dev_minus_qbar| (P_dev - n (x) n)
+    // The return mapping is repeated from the history without storing the internal variables.
+    void get_tangent(const double *strain, double *tangent, int n_points, int mat_index, ptrdiff_t first_point) override
+    {
+        const double bulk        = bulk_modulus[mat_index];
+        const double two_mu      = 2 * shear_modulus[mat_index];
+        const double kinematic   = -H[mat_index] * (2.0 / 3.0);
+        const double sigma_yield = yield_stress[mat_index];
+
+        alignas(64) double n[6][batch_size];
+        alignas(64) double norm_dev_minus_qbar[batch_size];
+        alignas(64) double q_trial[batch_size];
+        alignas(64) double f_trial[batch_size];
+        alignas(64) double gamma[batch_size];
+        alignas(64) double dgamma[batch_size];
+
+        for (int p0 = 0; p0 < n_points; p0 += batch_size) {
+            const int       nb     = std::min(batch_size, n_points - p0);
+            const ptrdiff_t point0 = first_point + p0;
+
+#pragma omp simd
+            for (int p = 0; p < nb; ++p) {
+                const double *e  = strain + 6 * (p0 + p);
+                const double *ep = plasticStrain_t + 6 * (point0 + p);
+                const double *pb = psi_bar_t + 6 * (point0 + p);
+                double        eps_elastic[6], dev_minus_qbar[6];
+                for (int j = 0; j < 6; ++j)
+                    eps_elastic[j] = e[j] - ep[j];
+                const double trdev = (eps_elastic[0] + eps_elastic[1] + eps_elastic[2]) / 3.0;
+                double       norm  = 0.0;
+                for (int j = 0; j < 3; ++j) {
+                    dev_minus_qbar[j]     = two_mu * (eps_elastic[j] - trdev) - kinematic * pb[j];
+                    dev_minus_qbar[j + 3] = two_mu * eps_elastic[j + 3];
+                }
+                for (int j = 0; j < 6; ++j)
+                    norm += dev_minus_qbar[j] * dev_minus_qbar[j];
+                norm                   = sqrt(norm);
+                norm_dev_minus_qbar[p] = norm;
+                for (int j = 0; j < 6; ++j)
+                    n[j][p] = (norm < 1e-12) ? 0.0 : dev_minus_qbar[j] / norm;
+            }
 
-        // Assign final stress
-        sigma.block<6, 1>(i, 0) = sigma_trial_n1;
+            compute_q_trial(psi_t + point0, q_trial, nb, mat_index);
+            for (int p = 0; p < nb; ++p)
+                f_trial[p] = norm_dev_minus_qbar[p] - sqrt_two_over_three * (sigma_yield - q_trial[p]);
+            compute_gamma(f_trial, psi_t + point0, gamma, nb, mat_index);
+            compute_dgamma(f_trial, psi_t + point0, gamma, dgamma, nb, mat_index);
+
+            for (int p = 0; p < nb; ++p) {
+                Map<Matrix<double, 6, 6>> C(tangent + 36 * (p0 + p));
+                C.setZero();
+                C.topLeftCorner<3, 3>().setConstant(bulk);
+                C.diagonal().array() += two_mu;
+
+                const double a = two_mu * two_mu * dgamma[p];
+                const double b = (norm_dev_minus_qbar[p] < 1e-12) ? 0.0 : two_mu * two_mu * gamma[p] / norm_dev_minus_qbar[p];
+                if (a != 0.0 || b != 0.0) {
+                    Matrix<double, 6, 1> n_p;
+                    for (int j = 0; j < 6; ++j)
+                        n_p(j) = n[j][p];
+                    C.diagonal().array() -= b;
+                    C.topLeftCorner<3, 3>().array() += b / 3.0;
+                    C.noalias() += (b - a) * n_p * n_p.transpose();
+                }
+            }
+        }
     }
 
-    // Virtual methods for derived classes to implement different behaviors
-    virtual double compute_q_trial(double psi_val, int mat_index)                             = 0;
-    virtual double compute_gamma(double f_trial, int mat_index, int i, ptrdiff_t element_idx) = 0;
+    // Hardening laws of the derived classes, evaluated for n_points points at once:
+    // q_trial from the isotropic hardening variable psi_t, the plastic multiplier gamma from the trial yield
+    // function f_trial (gamma = 0 where f_trial < 0) and its derivative dgamma = d gamma / d f_trial
+    virtual void compute_q_trial(const double *psi_t, double *q_trial, int n_points, int mat_index)                                           = 0;
+    virtual void compute_gamma(const double *f_trial, const double *psi_t, double *gamma, int n_points, int mat_index)                         = 0;
+    virtual void compute_dgamma(const double *f_trial, const double *psi_t, const double *gamma, double *dgamma, int n_points, int mat_index) = 0;
 
-    void postprocess(Solver<3> &solver, Reader &reader, const char *resultsFileName, int load_idx, int time_idx) override;
+    void postprocess(Reader &reader, const char *resultsFileName, int load_idx, int time_idx) override;
 
   protected:
     // Material properties
@@ -132,26 +257,27 @@ class J2Plasticity : public MechModel {
     vector<double> eta; // Viscosity parameter
     double         dt;  // Time step
 
-    // Internal variables
-    vector<Matrix<double, 6, Dynamic>> plasticStrain;
-    vector<Matrix<double, 6, Dynamic>> plasticStrain_t;
-    vector<VectorXd>                   psi;
-    vector<VectorXd>                   psi_t;
-    vector<Matrix<double, 6, Dynamic>> psi_bar;
-    vector<Matrix<double, 6, Dynamic>> psi_bar_t;
-
-    // Preallocated member variables for reuse
-    Matrix<double, 6, 1> sigma_trial_n1;
-    Matrix<double, 6, 1> dev;
-    Matrix<double, 6, 1> qbar_trial_n1;
-    Matrix<double, 6, 1> n;
-    Matrix<double, 6, 1> eps_elastic;
-    double               treps;
-    double               q_trial_n1;
-    double               f_trial;
-    Matrix<double, 6, 1> dev_minus_qbar;
-    double               norm_dev_minus_qbar;
-    double               gamma_n1;
+    // Internal variables (FANS_malloc buffers, see initializeInternalVariables)
+    size_t  num_points      = 0; // Number of elements times Gauss points
+    int     n_gp            = 0; // Number of Gauss points per element
+    double *plasticStrain   = nullptr;
+    double *plasticStrain_t = nullptr;
+    double *psi             = nullptr;
+    double *psi_t           = nullptr;
+    double *psi_bar         = nullptr;
+    double *psi_bar_t       = nullptr;
+
+    void free_internal_variables()
+    {
+        for (double *buffer : {plasticStrain, plasticStrain_t, psi, psi_t, psi_bar, psi_bar_t}) {
+            if (buffer != nullptr)
+                FANS_free(buffer);
+        }
+        plasticStrain = plasticStrain_t = psi = psi_t = psi_bar = psi_bar_t = nullptr;
+        num_points    = 0;
+    }
+
+    static constexpr int batch_size = 8; // Points per chunk of the return mapping
     double               sqrt_two_over_three;
 };
 
@@ -163,14 +289,28 @@ class J2ViscoPlastic_LinearIsotropicHardening : public J2Plasticity {
     {
     }
 
-    double compute_q_trial(double psi_val, int mat_index) override
+    void compute_q_trial(const double *psi_t, double *q_trial, int n_points, int mat_index) override
+    {
+        const double k = K[mat_index];
+#pragma omp simd
+        for (int p = 0; p < n_points; ++p)
+            q_trial[p] = -k * psi_t[p];
+    }
+
+    void compute_gamma(const double *f_trial, const double *psi_t, double *gamma, int n_points, int mat_index) override
     {
-        return -K[mat_index] * psi_val;
+        const double denominator = 2 * shear_modulus[mat_index] + (2.0 / 3.0) * (K[mat_index] + H[mat_index]) + eta[mat_index] / dt;
+#pragma omp simd
+        for (int p = 0; p < n_points; ++p)
+            gamma[p] = (f_trial[p] < 0) ? 0.0 : f_trial[p] / denominator;
     }
 
-    double compute_gamma(double f_trial, int mat_index, int i, ptrdiff_t element_idx) override
+    void compute_dgamma(const double *f_trial, const double *psi_t, const double *gamma, double *dgamma, int n_points, int mat_index) override
     {
-        return f_trial / (2 * shear_modulus[mat_index] + (2.0 / 3.0) * (K[mat_index] + H[mat_index]) + eta[mat_index] / dt);
+        const double denominator = 2 * shear_modulus[mat_index] + (2.0 / 3.0) * (K[mat_index] + H[mat_index]) + eta[mat_index] / dt;
+#pragma omp simd
+        for (int p = 0; p < n_points; ++p)
+            dgamma[p] = (f_trial[p] < 0) ? 0.0 : 1.0 / denominator;
     }
 };
 
@@ -196,27 +336,48 @@ class J2ViscoPlastic_NonLinearIsotropicHardening : public J2Plasticity {
         }
     }
 
-    double compute_q_trial(double psi_val, int mat_index) override
+    void compute_q_trial(const double *psi_t, double *q_trial, int n_points, int mat_index) override
     {
-        return -K[mat_index] * psi_val - (sigma_inf[mat_index] - yield_stress[mat_index]) * (1 - exp(-delta[mat_index] * psi_val));
+        const double k          = K[mat_index];
+        const double saturation = sigma_inf[mat_index] - yield_stress[mat_index];
+        const double d          = delta[mat_index];
+#pragma omp simd
+        for (int p = 0; p < n_points; ++p)
+            q_trial[p] = -k * psi_t[p] - saturation * (1 - exp(-d * psi_t[p]));
     }
 
-    double compute_gamma(double f_trial, int mat_index, int i, ptrdiff_t element_idx) override
+    // Newton-Raphson per plastic point, the number of iterations differs between the points
+    void compute_gamma(const double *f_trial, const double *psi_t, double *gamma, int n_points, int mat_index) override
     {
-        gamma_n1  = 0;
-        gamma_inc = 1;
-        NR_iter   = 0;
-        while (gamma_inc > NR_tol && NR_iter < NR_max_iter) {
-            g = f_trial - gamma_n1 * denominator[mat_index] -
-                sigma_diff[mat_index] *
-                    (-exp(-delta[mat_index] * (psi_t[element_idx](i / n_str) + sqrt_two_over_three * gamma_n1)) + exp(-delta[mat_index] * psi_t[element_idx](i / n_str)));
-            dg = -denominator[mat_index] -
-                 (2 / 3) * (sigma_inf[mat_index] - yield_stress[mat_index]) * delta[mat_index] * exp(-delta[mat_index] * (psi_t[element_idx](i / n_str) + sqrt_two_over_three * gamma_n1));
-            gamma_inc = -g / dg;
-            gamma_n1 += gamma_inc;
-            NR_iter++;
+        for (int p = 0; p < n_points; ++p) {
+            double gamma_n1 = 0;
+            if (f_trial[p] >= 0) {
+                double gamma_inc = 1;
+                int    NR_iter   = 0;
+                while (std::abs(gamma_inc) > NR_tol && NR_iter < NR_max_iter) {
+                    const double g = f_trial[p] - gamma_n1 * denominator[mat_index] -
+                                     sigma_diff[mat_index] *
+                                         (-exp(-delta[mat_index] * (psi_t[p] + sqrt_two_over_three * gamma_n1)) + exp(-delta[mat_index] * psi_t[p]));
+                    const double dg = -denominator[mat_index] -
+                                      sqrt_two_over_three * sigma_diff[mat_index] * delta[mat_index] * exp(-delta[mat_index] * (psi_t[p] + sqrt_two_over_three * gamma_n1));
+                    gamma_inc = -g / dg;
+                    gamma_n1 += gamma_inc;
+                    NR_iter++;
+                }
+            }
+            gamma[p] = gamma_n1;
+        }
+    }
+
+    // Implicit derivative of the residual g(gamma) = 0 solved by compute_gamma
+    void compute_dgamma(const double *f_trial, const double *psi_t, const double *gamma, double *dgamma, int n_points, int mat_index) override
+    {
+        const double d = delta[mat_index];
+#pragma omp simd
+        for (int p = 0; p < n_points; ++p) {
+            const double dg = denominator[mat_index] + sqrt_two_over_three * sigma_diff[mat_index] * d * exp(-d * (psi_t[p] + sqrt_two_over_three * gamma[p]));
+            dgamma[p]       = (f_trial[p] < 0) ? 0.0 : 1.0 / dg;
         }
-        return gamma_n1;
     }
 
   protected:
@@ -227,63 +388,38 @@ class J2ViscoPlastic_NonLinearIsotropicHardening : public J2Plasticity {
     // Newton-Raphson parameters
     double NR_tol      = 1e-10;
     int    NR_max_iter = 10;
-    int    NR_iter;
-
-    // Preallocated member variables for reuse
-    double gamma_inc;
-    double g;
-    double dg;
 
     // Precomputed constants
     vector<double> denominator; // 2 * mu + H * (2/3) + eta/dt
     vector<double> sigma_diff;  // sqrt(2/3) * (sigma_inf - yield_stress)
 };
 
-void J2Plasticity::postprocess(Solver<3> &solver, Reader &reader, const char *resultsFileName, int load_idx, int time_idx)
+void J2Plasticity::postprocess(Reader &reader, const char *resultsFileName, int load_idx, int time_idx)
 {
     int      n_str                             = 6; // The plastic strain and stress vectors have 6 components each
-    VectorXd mean_plastic_strain               = VectorXd::Zero(solver.local_n0 * solver.n_y * solver.n_z * n_str);
-    VectorXd mean_isotropic_hardening_variable = VectorXd::Zero(solver.local_n0 * solver.n_y * solver.n_z);
-    VectorXd mean_kinematic_hardening_variable = VectorXd::Zero(solver.local_n0 * solver.n_y * solver.n_z * n_str);
-
-    // Compute the mean values for each element
-    for (ptrdiff_t elem_idx = 0; elem_idx < solver.local_n0 * solver.n_y * solver.n_z; ++elem_idx) {
-        mean_plastic_strain.segment(n_str * elem_idx, n_str)               = plasticStrain_t[elem_idx].rowwise().mean();
-        mean_isotropic_hardening_variable(elem_idx)                        = psi_t[elem_idx].mean();
-        mean_kinematic_hardening_variable.segment(n_str * elem_idx, n_str) = psi_bar_t[elem_idx].rowwise().mean();
+    VectorXd mean_plastic_strain               = VectorXd::Zero(reader.local_n0 * reader.dims[1] * reader.dims[2] * n_str);
+    VectorXd mean_isotropic_hardening_variable = VectorXd::Zero(reader.local_n0 * reader.dims[1] * reader.dims[2]);
+    VectorXd mean_kinematic_hardening_variable = VectorXd::Zero(reader.local_n0 * reader.dims[1] * reader.dims[2] * n_str);
+
+    // Compute the mean values for each element. The history is only updated by the next solve, the current buffers
+    // hold the state of the last stress evaluation, which Solver::postprocess does at the solution.
+    for (ptrdiff_t elem_idx = 0; elem_idx < reader.local_n0 * reader.dims[1] * reader.dims[2]; ++elem_idx) {
+        const ptrdiff_t first_point                                        = elem_idx * n_gp;
+        mean_plastic_strain.segment(n_str * elem_idx, n_str)               = Map<Matrix<double, 6, Dynamic>>(plasticStrain + 6 * first_point, 6, n_gp).rowwise().mean();
+        mean_isotropic_hardening_variable(elem_idx)                        = Map<VectorXd>(psi + first_point, n_gp).mean();
+        mean_kinematic_hardening_variable.segment(n_str * elem_idx, n_str) = Map<Matrix<double, 6, Dynamic>>(psi_bar + 6 * first_point, 6, n_gp).rowwise().mean();
     }
 
     if (find(reader.resultsToWrite.begin(), reader.resultsToWrite.end(), "plastic_strain") != reader.resultsToWrite.end()) {
-        for (int i = 0; i < solver.world_size; ++i) {
-            if (i == solver.world_rank) {
-                char name[5096];
-                sprintf(name, "%s/load%i/time_step%i/plastic_strain", reader.ms_datasetname, load_idx, time_idx);
-                reader.WriteSlab<double>(mean_plastic_strain.data(), n_str, resultsFileName, name);
-            }
-            MPI_Barrier(MPI_COMM_WORLD);
-        }
+        reader.WriteResultSlab<double>(mean_plastic_strain.data(), n_str, resultsFileName, load_idx, time_idx, "plastic_strain");
     }
 
     if (find(reader.resultsToWrite.begin(), reader.resultsToWrite.end(), "isotropic_hardening_variable") != reader.resultsToWrite.end()) {
-        for (int i = 0; i < solver.world_size; ++i) {
-            if (i == solver.world_rank) {
-                char name[5096];
-                sprintf(name, "%s/load%i/time_step%i/isotropic_hardening_variable", reader.ms_datasetname, load_idx, time_idx);
-                reader.WriteSlab<double>(mean_isotropic_hardening_variable.data(), 1, resultsFileName, name);
-            }
-            MPI_Barrier(MPI_COMM_WORLD);
-        }
+        reader.WriteResultSlab<double>(mean_isotropic_hardening_variable.data(), 1, resultsFileName, load_idx, time_idx, "isotropic_hardening_variable");
     }
 
     if (find(reader.resultsToWrite.begin(), reader.resultsToWrite.end(), "kinematic_hardening_variable") != reader.resultsToWrite.end()) {
-        for (int i = 0; i < solver.world_size; ++i) {
-            if (i == solver.world_rank) {
-                char name[5096];
-                sprintf(name, "%s/load%i/time_step%i/kinematic_hardening_variable", reader.ms_datasetname, load_idx, time_idx);
-                reader.WriteSlab<double>(mean_kinematic_hardening_variable.data(), n_str, resultsFileName, name);
-            }
-            MPI_Barrier(MPI_COMM_WORLD);
-        }
+        reader.WriteResultSlab<double>(mean_kinematic_hardening_variable.data(), n_str, resultsFileName, load_idx, time_idx, "kinematic_hardening_variable");
     }
 }
 
@@ -51,16 +51,22 @@ class LinearElasticIsotropic : public MechModel, public LinearModel<3> {
         }
     }
 
-    void get_sigma(int i, int mat_index, ptrdiff_t element_idx) override
+    void get_sigma(const double *strain, double *stress, int n_points, int mat_index, ptrdiff_t first_point) override
     {
-        double buf1     = lambda[mat_index] * (eps(i, 0) + eps(i + 1, 0) + eps(i + 2, 0));
-        double buf2     = 2 * mu[mat_index];
-        sigma(i + 0, 0) = buf1 + buf2 * eps(i + 0, 0);
-        sigma(i + 1, 0) = buf1 + buf2 * eps(i + 1, 0);
-        sigma(i + 2, 0) = buf1 + buf2 * eps(i + 2, 0);
-        sigma(i + 3, 0) = buf2 * eps(i + 3, 0);
-        sigma(i + 4, 0) = buf2 * eps(i + 4, 0);
-        sigma(i + 5, 0) = buf2 * eps(i + 5, 0);
+        const double lambda_i = lambda[mat_index];
+        const double two_mu   = 2 * mu[mat_index];
+#pragma omp simd
+        for (int p = 0; p < n_points; ++p) {
+            const double *e    = strain + 6 * p;
+            double       *s    = stress + 6 * p;
+            const double  buf1 = lambda_i * (e[0] + e[1] + e[2]);
+            s[0]               = buf1 + two_mu * e[0];
+            s[1]               = buf1 + two_mu * e[1];
+            s[2]               = buf1 + two_mu * e[2];
+            s[3]               = two_mu * e[3];
+            s[4]               = two_mu * e[4];
+            s[5]               = two_mu * e[5];
+        }
     }
 
   private:
@@ -137,9 +143,9 @@ class LinearElasticTriclinic : public MechModel, public LinearModel<3> {
         }
     }
 
-    void get_sigma(int i, int mat_index, ptrdiff_t element_idx) override
+    void get_sigma(const double *strain, double *stress, int n_points, int mat_index, ptrdiff_t first_point) override
     {
-        sigma.segment<6>(i) = C_mats[mat_index] * eps.segment<6>(i);
+        Map<Matrix<double, 6, Dynamic>>(stress, 6, n_points).noalias() = C_mats[mat_index] * Map<const Matrix<double, 6, Dynamic>>(strain, 6, n_points);
     }
 
   private:
@@ -34,11 +34,13 @@ class LinearThermalIsotropic : public ThermalModel, public LinearModel<1> {
         }
     }
 
-    void get_sigma(int i, int mat_index, ptrdiff_t element_idx) override
+    void get_sigma(const double *strain, double *stress, int n_points, int mat_index, ptrdiff_t first_point) override
     {
-        sigma(i + 0, 0) = conductivity[mat_index] * eps(i + 0, 0);
-        sigma(i + 1, 0) = conductivity[mat_index] * eps(i + 1, 0);
-        sigma(i + 2, 0) = conductivity[mat_index] * eps(i + 2, 0);
+        const double k = conductivity[mat_index];
+#pragma omp simd
+        for (int j = 0; j < 3 * n_points; ++j) {
+            stress[j] = k * strain[j];
+        }
     }
 
   private:
@@ -102,9 +104,9 @@ class LinearThermalTriclinic : public ThermalModel, public LinearModel<1> {
         }
     }
 
-    void get_sigma(int i, int mat_index, ptrdiff_t element_idx) override
+    void get_sigma(const double *strain, double *stress, int n_points, int mat_index, ptrdiff_t first_point) override
     {
-        sigma.segment<3>(i) = K_mats[mat_index] * eps.segment<3>(i);
+        Map<Matrix<double, 3, Dynamic>>(stress, 3, n_points).noalias() = K_mats[mat_index] * Map<const Matrix<double, 3, Dynamic>>(strain, 3, n_points);
     }
 
   private:
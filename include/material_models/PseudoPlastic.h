@@ -16,7 +16,6 @@
 #define PSEUDOPLASTIC_H
 
 #include "matmodel.h"
-#include "solver.h"
 
 class PseudoPlastic : public MechModel {
   public:
@@ -48,38 +47,49 @@ class PseudoPlastic : public MechModel {
 
     void initializeInternalVariables(ptrdiff_t num_elements, int num_gauss_points) override
     {
-        plastic_flag.resize(num_elements, VectorXi::Zero(num_gauss_points));
+        // One flag per Gauss point, element after element
+        n_gp = num_gauss_points;
+        plastic_flag.setZero(num_elements * num_gauss_points);
     }
 
-    virtual void get_sigma(int i, int mat_index, ptrdiff_t element_idx) override = 0; // Pure virtual method
-
-    void postprocess(Solver<3> &solver, Reader &reader, const char *resultsFileName, int load_idx, int time_idx) override
+    void postprocess(Reader &reader, const char *resultsFileName, int load_idx, int time_idx) override
     {
-        VectorXf element_plastic_flag = VectorXf::Zero(solver.local_n0 * solver.n_y * solver.n_z);
-        for (ptrdiff_t elem_idx = 0; elem_idx < solver.local_n0 * solver.n_y * solver.n_z; ++elem_idx) {
-            element_plastic_flag(elem_idx) = plastic_flag[elem_idx].cast<float>().mean();
+        VectorXf element_plastic_flag = VectorXf::Zero(reader.local_n0 * reader.dims[1] * reader.dims[2]);
+        for (ptrdiff_t elem_idx = 0; elem_idx < reader.local_n0 * reader.dims[1] * reader.dims[2]; ++elem_idx) {
+            element_plastic_flag(elem_idx) = plastic_flag.segment(elem_idx * n_gp, n_gp).cast<float>().mean();
         }
 
         if (find(reader.resultsToWrite.begin(), reader.resultsToWrite.end(), "plastic_flag") != reader.resultsToWrite.end()) {
-            for (int i = 0; i < solver.world_size; ++i) {
-                if (i == solver.world_rank) {
-                    char name[5096];
-                    sprintf(name, "%s/load%i/time_step%i/plastic_flag", reader.ms_datasetname, load_idx, time_idx);
-                    reader.WriteSlab<float>(element_plastic_flag.data(), 1, resultsFileName, name);
-                }
-                MPI_Barrier(MPI_COMM_WORLD);
-            }
+            reader.WriteResultSlab<float>(element_plastic_flag.data(), 1, resultsFileName, load_idx, time_idx, "plastic_flag");
         }
     }
 
+    bool has_tangent() const override
+    {
+        return true;
+    }
+
   protected:
-    vector<double>       bulk_modulus;
-    vector<double>       shear_modulus;
-    vector<double>       yield_stress;
-    vector<double>       eps_crit;
-    vector<VectorXi>     plastic_flag;
-    Matrix<double, 6, 1> dev_eps;
-    double               treps, norm_dev_eps, buf1, buf2;
+    vector<double> bulk_modulus;
+    vector<double> shear_modulus;
+    vector<double> yield_stress;
+    vector<double> eps_crit;
+    VectorXi       plastic_flag;
+    int            n_gp = 0; // Number of Gauss points per element
+
+    // Tangent of stress = bulk tr(eps) 1 + secant dev_eps, where the norm of the deviatoric stress has the slope
+    // d |secant dev_eps| / d |dev_eps|:  C = bulk 1 (x) 1 + secant P_dev + (slope - secant) n (x) n, n = dev_eps / |dev_eps|
+    static void secant_tangent(double bulk, double secant, double slope, const double *dev_eps, double norm_dev_eps, double *tangent)
+    {
+        Map<Matrix<double, 6, 6>> C(tangent);
+        C.setZero();
+        C.topLeftCorner<3, 3>().setConstant(bulk - secant / 3.0);
+        C.diagonal().array() += secant;
+        if (slope != secant && norm_dev_eps > 0.0) {
+            Map<const Matrix<double, 6, 1>> n(dev_eps);
+            C.noalias() += (slope - secant) / (norm_dev_eps * norm_dev_eps) * n * n.transpose();
+        }
+    }
 };
 
 class PseudoPlasticLinearHardening : public PseudoPlastic {
@@ -102,27 +112,64 @@ class PseudoPlasticLinearHardening : public PseudoPlastic {
         }
     }
 
-    void get_sigma(int i, int mat_index, ptrdiff_t element_idx) override
+    // Branch-free over the points, so that the loop is vectorized
+    void get_sigma(const double *strain, double *stress, int n_points, int mat_index, ptrdiff_t first_point) override
     {
-        treps             = eps.block<3, 1>(i, 0).sum();
-        dev_eps.head<3>() = eps.block<3, 1>(i, 0) - (1.0 / 3.0) * treps * Matrix<double, 3, 1>::Ones();
-        dev_eps.tail<3>() = eps.block<3, 1>(i + 3, 0);
-
-        norm_dev_eps = dev_eps.norm();
-        buf1         = bulk_modulus[mat_index] * treps;
-
-        if (norm_dev_eps <= eps_crit[mat_index]) {
-            buf2                                 = 2.0 * shear_modulus[mat_index];
-            plastic_flag[element_idx](i / n_str) = mat_index;
-        } else {
-            buf2 = (b * yield_stress[mat_index] + a * E_s[mat_index] * hardening_parameter[mat_index] *
-                                                      (norm_dev_eps - eps_crit[mat_index])) /
-                   norm_dev_eps;
-            plastic_flag[element_idx](i / n_str) = this->n_mat + mat_index;
+        const double bulk      = bulk_modulus[mat_index];
+        const double two_mu    = 2.0 * shear_modulus[mat_index];
+        const double crit      = eps_crit[mat_index];
+        const double sigma_y   = b * yield_stress[mat_index];
+        const double hardening = a * E_s[mat_index] * hardening_parameter[mat_index];
+        const int    n_phases  = this->n_mat;
+        int         *flag      = plastic_flag.data() + first_point;
+#pragma omp simd
+        for (int p = 0; p < n_points; ++p) {
+            const double *e     = strain + 6 * p;
+            double       *s     = stress + 6 * p;
+            const double  treps = e[0] + e[1] + e[2];
+            double        dev_eps[6];
+            for (int j = 0; j < 3; ++j) {
+                dev_eps[j]     = e[j] - (1.0 / 3.0) * treps;
+                dev_eps[j + 3] = e[j + 3];
+            }
+            double norm_dev_eps = 0.0;
+            for (int j = 0; j < 6; ++j)
+                norm_dev_eps += dev_eps[j] * dev_eps[j];
+            norm_dev_eps = sqrt(norm_dev_eps);
+
+            const bool   elastic = norm_dev_eps <= crit;
+            const double buf1    = bulk * treps;
+            const double buf2    = elastic ? two_mu : (sigma_y + hardening * (norm_dev_eps - crit)) / norm_dev_eps;
+            flag[p]              = elastic ? mat_index : n_phases + mat_index;
+            for (int j = 0; j < 3; ++j) {
+                s[j]     = buf1 + buf2 * dev_eps[j];
+                s[j + 3] = buf2 * dev_eps[j + 3];
+            }
+        }
+    }
+
+    void get_tangent(const double *strain, double *tangent, int n_points, int mat_index, ptrdiff_t first_point) override
+    {
+        const double bulk      = bulk_modulus[mat_index];
+        const double two_mu    = 2.0 * shear_modulus[mat_index];
+        const double crit      = eps_crit[mat_index];
+        const double sigma_y   = b * yield_stress[mat_index];
+        const double hardening = a * E_s[mat_index] * hardening_parameter[mat_index];
+        for (int p = 0; p < n_points; ++p) {
+            const double *e     = strain + 6 * p;
+            const double  treps = e[0] + e[1] + e[2];
+            double        dev_eps[6];
+            for (int j = 0; j < 3; ++j) {
+                dev_eps[j]     = e[j] - (1.0 / 3.0) * treps;
+                dev_eps[j + 3] = e[j + 3];
+            }
+            const double norm_dev_eps = Map<const Matrix<double, 6, 1>>(dev_eps).norm();
+            if (norm_dev_eps <= crit) {
+                secant_tangent(bulk, two_mu, two_mu, dev_eps, norm_dev_eps, tangent + 36 * p);
+            } else {
+                secant_tangent(bulk, (sigma_y + hardening * (norm_dev_eps - crit)) / norm_dev_eps, hardening, dev_eps, norm_dev_eps, tangent + 36 * p);
+            }
         }
-        sigma.block<3, 1>(i, 0).setConstant(buf1);
-        sigma.block<3, 1>(i, 0) += buf2 * dev_eps.head<3>();
-        sigma.block<3, 1>(i + 3, 0) = buf2 * dev_eps.tail<3>();
     }
 
   private:
@@ -150,30 +197,69 @@ class PseudoPlasticNonLinearHardening : public PseudoPlastic {
         }
     }
 
-    void get_sigma(int i, int mat_index, ptrdiff_t element_idx) override
+    // Branch-free over the points, so that the loop is vectorized
+    void get_sigma(const double *strain, double *stress, int n_points, int mat_index, ptrdiff_t first_point) override
     {
-        treps             = eps.block<3, 1>(i, 0).sum();
-        dev_eps.head<3>() = eps.block<3, 1>(i, 0) - (1.0 / 3.0) * treps * Matrix<double, 3, 1>::Ones();
-        dev_eps.tail<3>() = eps.block<3, 1>(i + 3, 0);
-
-        norm_dev_eps = sqrt(2.0 / 3.0) * dev_eps.norm(); // ε_eq
-
-        buf1 = bulk_modulus[mat_index] * treps;
-        sigma.block<6, 1>(i, 0).setConstant(0);
-        if (norm_dev_eps <= eps_crit[mat_index]) {
-            buf2 = 2.0 * shear_modulus[mat_index];
-            sigma.block<3, 1>(i, 0).setConstant(buf1);
-            sigma.block<3, 1>(i, 0) += buf2 * dev_eps.head<3>();
-            sigma.block<3, 1>(i + 3, 0) = buf2 * dev_eps.tail<3>();
-
-            plastic_flag[element_idx](i / n_str) = mat_index;
-        } else {
-            buf2 = sqrt(2.0 / 3.0) * yield_stress[mat_index] *
-                   pow(norm_dev_eps / eps_0[mat_index], hardening_exponent[mat_index]);
-            sigma.block<3, 1>(i, 0).setConstant(buf1);
-            sigma.block<6, 1>(i, 0) += buf2 * dev_eps / dev_eps.norm();
-
-            plastic_flag[element_idx](i / n_str) = this->n_mat + mat_index;
+        const double bulk     = bulk_modulus[mat_index];
+        const double two_mu   = 2.0 * shear_modulus[mat_index];
+        const double crit     = eps_crit[mat_index];
+        const double sigma_y  = sqrt(2.0 / 3.0) * yield_stress[mat_index];
+        const double eps_ref  = eps_0[mat_index];
+        const double exponent = hardening_exponent[mat_index];
+        const int    n_phases = this->n_mat;
+        int         *flag     = plastic_flag.data() + first_point;
+#pragma omp simd
+        for (int p = 0; p < n_points; ++p) {
+            const double *e     = strain + 6 * p;
+            double       *s     = stress + 6 * p;
+            const double  treps = e[0] + e[1] + e[2];
+            double        dev_eps[6];
+            for (int j = 0; j < 3; ++j) {
+                dev_eps[j]     = e[j] - (1.0 / 3.0) * treps;
+                dev_eps[j + 3] = e[j + 3];
+            }
+            double norm_dev_eps = 0.0;
+            for (int j = 0; j < 6; ++j)
+                norm_dev_eps += dev_eps[j] * dev_eps[j];
+            norm_dev_eps = sqrt(norm_dev_eps);
+
+            const double eps_eq  = sqrt(2.0 / 3.0) * norm_dev_eps; // ε_eq
+            const bool   elastic = eps_eq <= crit;
+            const double buf1    = bulk * treps;
+            const double buf2    = elastic ? two_mu : sigma_y * pow(eps_eq / eps_ref, exponent) / norm_dev_eps;
+            flag[p]              = elastic ? mat_index : n_phases + mat_index;
+            for (int j = 0; j < 3; ++j) {
+                s[j]     = buf1 + buf2 * dev_eps[j];
+                s[j + 3] = buf2 * dev_eps[j + 3];
+            }
+        }
+    }
+
+    // The deviatoric stress norm is a power law of |dev_eps|, so its slope is exponent times the secant
+    void get_tangent(const double *strain, double *tangent, int n_points, int mat_index, ptrdiff_t first_point) override
+    {
+        const double bulk     = bulk_modulus[mat_index];
+        const double two_mu   = 2.0 * shear_modulus[mat_index];
+        const double crit     = eps_crit[mat_index];
+        const double sigma_y  = sqrt(2.0 / 3.0) * yield_stress[mat_index];
+        const double eps_ref  = eps_0[mat_index];
+        const double exponent = hardening_exponent[mat_index];
+        for (int p = 0; p < n_points; ++p) {
+            const double *e     = strain + 6 * p;
+            const double  treps = e[0] + e[1] + e[2];
+            double        dev_eps[6];
+            for (int j = 0; j < 3; ++j) {
+                dev_eps[j]     = e[j] - (1.0 / 3.0) * treps;
+                dev_eps[j + 3] = e[j + 3];
+            }
+            const double norm_dev_eps = Map<const Matrix<double, 6, 1>>(dev_eps).norm();
+            const double eps_eq       = sqrt(2.0 / 3.0) * norm_dev_eps;
+            if (eps_eq <= crit) {
+                secant_tangent(bulk, two_mu, two_mu, dev_eps, norm_dev_eps, tangent + 36 * p);
+            } else {
+                const double secant = sigma_y * pow(eps_eq / eps_ref, exponent) / norm_dev_eps;
+                secant_tangent(bulk, secant, exponent * secant, dev_eps, norm_dev_eps, tangent + 36 * p);
+            }
         }
     }
 
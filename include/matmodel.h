@@ -13,9 +13,6 @@ constexpr int get_n_str(int h)
         return 6;
     }
 }
-template <int howmany>
-class Solver;
-
 template <int howmany>
 class Matmodel {
   public:
@@ -29,21 +26,57 @@ class Matmodel {
     double *strain; //!< Gradient
     double *stress; //!< Flux
 
+    // Scratch of a single element evaluation. The model itself holds no mutable scratch, so one instance can be
+    // evaluated concurrently as long as every thread (or call) passes its own workspace.
+    struct Workspace {
+        Matrix<double, n_str * 8, 1>     eps;     //!< Gradient at the Gauss points
+        Matrix<double, n_str * 8, 1>     sigma;   //!< Flux at the Gauss points
+        Matrix<double, n_str, n_str * 8> tangent; //!< Consistent tangent at the Gauss points, one block per point
+        Matrix<double, n_str * 8, 1>     deps;    //!< Gradient increment at the Gauss points
+    };
+
     Matmodel(vector<double> l_e);
 
     Matrix<double, howmany * 8, howmany * 8> Compute_Reference_ElementStiffness();
-    Matrix<double, howmany * 8, 1>          &element_residual(Matrix<double, howmany * 8, 1> &ue, int mat_index, ptrdiff_t element_idx);
-    void                                     getStrainStress(double *strain, double *stress, Matrix<double, howmany * 8, 1> &ue, int mat_index, ptrdiff_t element_idx);
+    void                                     element_residual(const Matrix<double, howmany * 8, 1> &ue, int mat_index, ptrdiff_t element_idx, Matrix<double, howmany * 8, 1> &res_e, Workspace &ws);
+    void                                     getStrainStress(double *strain, double *stress, const Matrix<double, howmany * 8, 1> &ue, int mat_index, ptrdiff_t element_idx, Workspace &ws);
+    void                                     element_gradient(const Matrix<double, howmany * 8, 1> &ue, Matrix<double, n_str * 8, 1> &eps) const;
+    template <int n_col>
+    void element_divergence(const Matrix<double, n_str * 8, n_col> &sigma, Matrix<double, howmany * 8, n_col> &res_e) const;
+    template <int n_col>
+    void element_gradient_increment(const Matrix<double, howmany * 8, n_col> &due, Matrix<double, n_str * 8, n_col> &deps) const;
+    void                                     element_tangent_product(const Matrix<double, howmany * 8, 1> &ue, const Matrix<double, howmany * 8, 1> &due, int mat_index, ptrdiff_t element_idx, Matrix<double, howmany * 8, 1> &res_e, Workspace &ws);
     void                                     setGradient(vector<double> _g0);
 
-    virtual void postprocess(Solver<howmany> &solver, Reader &reader, const char *resultsFileName, int load_idx, int time_idx) {}
+    virtual void postprocess(Reader &reader, const char *resultsFileName, int load_idx, int time_idx) {}
 
     virtual void initializeInternalVariables(ptrdiff_t num_elements, int num_gauss_points) {}
     virtual void updateInternalVariables() {}
 
+    // Evaluates the stress at n_points Gauss points of phase mat_index at once. strain and stress hold n_str values
+    // per point, point after point. first_point (= 8 * element_idx + Gauss point) locates the internal variables of
+    // the first point, models with history store them per point in the same order.
+    virtual void get_sigma(const double *strain, double *stress, int n_points, int mat_index, ptrdiff_t first_point) = 0;
+
+    // Consistent (algorithmic) tangent d stress / d strain for the same arguments as get_sigma, one n_str x n_str block
+    // per point (column-major). Only reads the internal variables of the last converged step, i.e. it may be evaluated
+    // concurrently and repeatedly. Optional, required by the method "newton_cg" for models that are not linear.
+    virtual bool has_tangent() const
+    {
+        return false;
+    }
+    virtual void get_tangent(const double *strain, double *tangent, int n_points, int mat_index, ptrdiff_t first_point)
+    {
+        throw std::runtime_error("The material model does not provide a consistent tangent");
+    }
+
     vector<double>               macroscale_loading;
     Matrix<double, n_str, n_str> kapparef_mat; // Reference conductivity matrix
 
+    typedef std::vector<Matrix<double, n_str, n_str>, Eigen::aligned_allocator<Matrix<double, n_str, n_str>>> StiffnessList;
+    StiffnessList initial_stiffness();                                     // Stiffness of every phase at zero strain
+    Vector2d      relative_stiffness_bounds(const StiffnessList &C) const; // Extreme eigenvalues of kapparef_mat^-1 C[i]
+
     virtual ~Matmodel() = default;
 
   protected:
@@ -56,16 +89,11 @@ class Matmodel {
     Matrix<double, n_str, howmany * 8>     B_int[8];  //!< precomputed B matrix at all integration points
     Matrix<double, 8 * n_str, howmany * 8> B;
 
-    Matrix<double, n_str * 8, 1>   eps;
-    Matrix<double, n_str * 8, 1>   g0; //!< Macro-scale Gradient
-    Matrix<double, n_str * 8, 1>   sigma;
-    Matrix<double, howmany * 8, 1> res_e;
+    Matrix<double, n_str * 8, 1> g0; //!< Macro-scale Gradient
 
     Matrix<double, 3, 8>                       Compute_basic_B(const double x, const double y, const double z) const;
     virtual Matrix<double, n_str, howmany * 8> Compute_B(const double x, const double y, const double z) = 0;
     void                                       Construct_B();
-
-    virtual void get_sigma(int i, int mat_index, ptrdiff_t element_idx) = 0;
 };
 
 template <int howmany>
@@ -128,33 +156,25 @@ Matrix<double, 3, 8> Matmodel<howmany>::Compute_basic_B(const double x, const do
 }
 
 template <int howmany>
-Matrix<double, howmany * 8, 1> &Matmodel<howmany>::element_residual(Matrix<double, howmany * 8, 1> &ue, int mat_index, ptrdiff_t element_idx)
+void Matmodel<howmany>::element_residual(const Matrix<double, howmany * 8, 1> &ue, int mat_index, ptrdiff_t element_idx, Matrix<double, howmany * 8, 1> &res_e, Workspace &ws)
 {
-
-    eps.noalias() = B * ue + g0;
-
-    for (int i = 0; i < 8; ++i) {
-        get_sigma(n_str * i, mat_index, element_idx);
-    }
-    res_e.noalias() = B.transpose() * sigma * v_e * 0.125;
-    return res_e;
+    ws.eps.noalias() = B * ue + g0;
+    get_sigma(ws.eps.data(), ws.sigma.data(), 8, mat_index, 8 * element_idx);
+    res_e.noalias() = B.transpose().lazyProduct(ws.sigma) * (v_e * 0.125);
 }
 template <int howmany>
-void Matmodel<howmany>::getStrainStress(double *strain, double *stress, Matrix<double, howmany * 8, 1> &ue, int mat_index, ptrdiff_t element_idx)
+void Matmodel<howmany>::getStrainStress(double *strain, double *stress, const Matrix<double, howmany * 8, 1> &ue, int mat_index, ptrdiff_t element_idx, Workspace &ws)
 {
-    eps.noalias() = B * ue + g0;
-    sigma.setZero();
-    for (int i = 0; i < 8; ++i) {
-        get_sigma(n_str * i, mat_index, element_idx);
-    }
+    ws.eps.noalias() = B * ue + g0;
+    get_sigma(ws.eps.data(), ws.sigma.data(), 8, mat_index, 8 * element_idx);
 
     Matrix<double, n_str, 1> avg_strain = Matrix<double, n_str, 1>::Zero();
     Matrix<double, n_str, 1> avg_stress = Matrix<double, n_str, 1>::Zero();
 
     for (int i = 0; i < 8; ++i) {
         for (int j = 0; j < n_str; ++j) {
-            avg_strain(j) += eps(i * n_str + j) * 0.125;
-            avg_stress(j) += sigma(i * n_str + j) * 0.125;
+            avg_strain(j) += ws.eps(i * n_str + j) * 0.125;
+            avg_stress(j) += ws.sigma(i * n_str + j) * 0.125;
         }
     }
 
@@ -164,6 +184,73 @@ void Matmodel<howmany>::getStrainStress(double *strain, double *stress, Matrix<d
     }
 }
 
+// Gradient at the Gauss points including the macroscale gradient, eps = B ue + g0
+template <int howmany>
+void Matmodel<howmany>::element_gradient(const Matrix<double, howmany * 8, 1> &ue, Matrix<double, n_str * 8, 1> &eps) const
+{
+    eps.noalias() = B * ue + g0;
+}
+
+// Element residual of a given flux at the Gauss points, res_e = B^T sigma weighted with the Gauss weights. Every column
+// is a separate flux, e.g. one per load direction of the homogenized tangent.
+template <int howmany>
+template <int n_col>
+void Matmodel<howmany>::element_divergence(const Matrix<double, n_str * 8, n_col> &sigma, Matrix<double, howmany * 8, n_col> &res_e) const
+{
+    res_e.noalias() = B.transpose().lazyProduct(sigma) * (v_e * 0.125);
+}
+
+// Gradient of the element displacements due at the Gauss points without the macroscale gradient, deps = B due
+template <int howmany>
+template <int n_col>
+void Matmodel<howmany>::element_gradient_increment(const Matrix<double, howmany * 8, n_col> &due, Matrix<double, n_str * 8, n_col> &deps) const
+{
+    deps.noalias() = B * due;
+}
+
+// The tangent at zero strain for models that provide one, the stress of unit strains for the linear models. Models with
+// history use the internal variables of the first Gauss point, i.e. the elastic stiffness before the first time step.
+template <int howmany>
+typename Matmodel<howmany>::StiffnessList Matmodel<howmany>::initial_stiffness()
+{
+    StiffnessList C(n_mat);
+    for (int i = 0; i < n_mat; ++i) {
+        if (has_tangent()) {
+            Matrix<double, n_str, 1> zero = Matrix<double, n_str, 1>::Zero();
+            get_tangent(zero.data(), C[i].data(), 1, i, 0);
+        } else {
+            Matrix<double, n_str, n_str> unit = Matrix<double, n_str, n_str>::Identity();
+            get_sigma(unit.data(), C[i].data(), n_str, i, 0);
+        }
+    }
+    return C;
+}
+
+template <int howmany>
+Vector2d Matmodel<howmany>::relative_stiffness_bounds(const StiffnessList &C) const
+{
+    Vector2d bounds(std::numeric_limits<double>::max(), 0.0);
+    for (const auto &C_i : C) {
+        GeneralizedSelfAdjointEigenSolver<Matrix<double, n_str, n_str>> ges(C_i, kapparef_mat, EigenvaluesOnly);
+        bounds(0) = std::min(bounds(0), ges.eigenvalues().minCoeff());
+        bounds(1) = std::max(bounds(1), ges.eigenvalues().maxCoeff());
+    }
+    return bounds;
+}
+
+// Linearized element residual: B^T C_t B due, with the tangent C_t evaluated at the displacement ue
+template <int howmany>
+void Matmodel<howmany>::element_tangent_product(const Matrix<double, howmany * 8, 1> &ue, const Matrix<double, howmany * 8, 1> &due, int mat_index, ptrdiff_t element_idx, Matrix<double, howmany * 8, 1> &res_e, Workspace &ws)
+{
+    ws.eps.noalias()  = B * ue + g0;
+    ws.deps.noalias() = B * due;
+    get_tangent(ws.eps.data(), ws.tangent.data(), 8, mat_index, 8 * element_idx);
+    for (int p = 0; p < 8; ++p) {
+        ws.sigma.template segment<n_str>(n_str * p).noalias() = ws.tangent.template block<n_str, n_str>(0, n_str * p) * ws.deps.template segment<n_str>(n_str * p);
+    }
+    res_e.noalias() = B.transpose().lazyProduct(ws.sigma) * (v_e * 0.125);
+}
+
 template <int howmany>
 void Matmodel<howmany>::setGradient(vector<double> _g0)
 {
@@ -140,9 +140,10 @@ struct MixedBC {
 // ---------------------------------------------------------------------------
 struct LoadCase {
     bool                   mixed = false;
-    vector<vector<double>> g0_path;     // legacy pure‑strain
-    MixedBC                mbc;         // mixed BC data
-    size_t                 n_steps = 0; // number of time steps
+    vector<vector<double>> g0_path;            // legacy pure‑strain
+    MixedBC                mbc;                // mixed BC data
+    size_t                 n_steps   = 0;      // number of time steps
+    string                 predictor = "none"; // initial guess of the time steps: "none", "linear" or "quadratic"
 };
 
 // ---------------------------------------------------------------------------
@@ -178,6 +179,25 @@ struct MixedBCController {
         solver.matmodel->setGradient(gvec);
     }
 
+    // polarization schemes: macro strain of the projection of the polarization field (mean y_mean) onto the compatible
+    // fields in the metric of C0 = c * kapparef_mat, which satisfies Q_Fᵀ C0 (E - y_mean) = P_F
+    template <typename SolverType>
+    void update_polarization(SolverType &solver, const VectorXd &y_mean, double c)
+    {
+        if (!mixed_active)
+            return;
+
+        if (mbc_local.idx_F.size()) {
+            VectorXd PF  = mbc_local.P_F_path.row(step_idx).transpose();
+            VectorXd E_E = mbc_local.Q_E * (mbc_local.Q_E.transpose() * g0_vec);
+            VectorXd rhs = PF / c + mbc_local.Q_F.transpose() * solver.matmodel->kapparef_mat * (y_mean - E_E);
+            g0_vec       = E_E + mbc_local.Q_F * (mbc_local.M * rhs);
+        }
+
+        vector<double> gvec(g0_vec.data(), g0_vec.data() + g0_vec.size());
+        solver.matmodel->setGradient(gvec);
+    }
+
     template <typename SolverType>
     void activate(SolverType &solver, const MixedBC &mbc_in, size_t t)
     {
@@ -3,9 +3,12 @@
 #define READER_H
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include "mixedBCs.h"
+#include "resultsWriter.h"
+#include "timer.h"
 
 using namespace std;
 
@@ -21,10 +24,22 @@ class Reader {
     json             errorParameters;
     json             microstructure;
     int              n_it;
+    int              n_threads; // Number of threads per MPI process (OpenMP and FFTW)
     vector<LoadCase> load_cases;
     string           problemType;
     string           matmodel;
     string           method;
+    string           green_operator;   // "tabulated" or "on_the_fly"
+    string           reference_medium; // "mean", "bounds" or "adaptive"
+    string           tangent_solver;   // "batched" or "sequential", see Solver::get_homogenized_tangent
+    string           precision;        // "double", "single" or "mixed"
+    string           fftw_planner;     // "estimate", "measure", "patient" or "wisdom_only"
+    string           fftw_wisdom_dir;  // Directory of the FFTW wisdom files, empty if wisdom is not stored
+    string           results_layout;   // "time_steps" or "time_series", see ResultsWriter
+
+    bool   phase_sorted_elements; // Element loops over per-phase element lists instead of the grid order
+    int    anderson_depth;        // Number of stored iterates of the "fp_anderson" method
+    double newton_forcing;        // Upper bound of the relative tolerance of the linear solves of "newton_cg"
 
     vector<string> resultsToWrite;
 
@@ -49,230 +64,67 @@ class Reader {
     void ReadMS(int hm);
     void ComputeVolumeFractions();
     // void ReadHDF5(char file_name[], char dset_name[]);
-    void safe_create_group(hid_t file, const char *const name);
 
+    // WriteSlab and WriteData are collective: every process has to call them with the same arguments.
+    // They write through the ResultsWriter of file_name (see Results).
     template <typename T>
     void WriteSlab(T *data, int _howmany, const char *file_name, const char *dset_name);
 
     template <typename T>
     void WriteData(T *data, const char *file_name, const char *dset_name, hsize_t *dims, int rank);
-};
-
-template <typename T>
-void Reader::WriteData(T *data, const char *file_name, const char *dset_name, hsize_t *dims, int rank)
-{
-    hid_t data_type;
-    if (std::is_same<T, double>::value) {
-        data_type = H5T_NATIVE_DOUBLE;
-    } else if (std::is_same<T, unsigned char>::value) {
-        data_type = H5T_NATIVE_UCHAR;
-    } else {
-        throw std::invalid_argument("Conversion of this data type to H5 data type not yet implemented");
-    }
-
-    hid_t plist_id;
-    hid_t file_id;
-    plist_id = H5Pcreate(H5P_FILE_ACCESS);
 
-    // TODO: refactor this into a general error handling method
-    /* Save old error handler */
-    herr_t (*old_func)(hid_t, void *);
-    void *old_client_data;
-    H5Eget_auto(H5E_DEFAULT, &old_func, &old_client_data);
-    /* Turn off error handling */
-    H5Eset_auto(H5E_DEFAULT, NULL, NULL);
+    // Result name of time step time_idx of load case load_idx, stored below the results group ms_datasetname
+    // according to results_layout (collective)
+    template <typename T>
+    void WriteResultSlab(T *data, int _howmany, const char *file_name, int load_idx, int time_idx, const char *name);
 
-    file_id = H5Fopen(file_name, H5F_ACC_RDWR, plist_id);
-    /* Restore previous error handler */
-    H5Eset_auto(H5E_DEFAULT, old_func, old_client_data);
+    template <typename T>
+    void WriteResultData(T *data, const char *file_name, int load_idx, int time_idx, const char *name, hsize_t *dims, int rank);
 
-    if (file_id < 0) {
-        file_id = H5Fcreate(file_name, H5F_ACC_EXCL, H5P_DEFAULT, plist_id);
-    }
-    H5Pclose(plist_id);
+    // The results file is kept open from OpenResultsFile until CloseResultsFile and shared by all copies of the
+    // Reader. Without it every copy which writes opens the file itself for its lifetime. All collective.
+    void           OpenResultsFile(const char *file_name);
+    void           CloseResultsFile();
+    void           FlushResultsFile();
+    ResultsWriter &Results(const char *file_name);
 
-    // Ensure all groups in the path are created
-    safe_create_group(file_id, dset_name);
+  private:
+    shared_ptr<ResultsWriter> results_writer;
 
-    // Check if the dataset already exists
-    if (H5Lexists(file_id, dset_name, H5P_DEFAULT) > 0) {
-        // If it exists, delete it
-        H5Ldelete(file_id, dset_name, H5P_DEFAULT);
-    }
+    string  result_path(int load_idx, int time_idx, const char *name) const;
+    hsize_t result_steps(int load_idx) const;
+};
 
-    // Create the data space for the dataset
-    hid_t dataspace_id = H5Screate_simple(rank, dims, NULL);
-    if (dataspace_id < 0) {
-        H5Fclose(file_id);
-        throw std::runtime_error("Error creating dataspace");
-    }
+template <typename T>
+void Reader::WriteData(T *data, const char *file_name, const char *dset_name, hsize_t *dims, int rank)
+{
+    Results(file_name).WriteData(data, dset_name, dims, rank);
+}
 
-    // Create the dataset with default properties
-    hid_t dataset_id = H5Dcreate2(file_id, dset_name, data_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-    if (dataset_id < 0) {
-        H5Sclose(dataspace_id);
-        H5Fclose(file_id);
-        throw std::runtime_error("Error creating dataset");
-    }
+template <typename T>
+void Reader::WriteSlab(T *data, int _howmany, const char *file_name, const char *dset_name)
+{
+    Results(file_name).WriteSlab(data, _howmany, dset_name);
+}
 
-    // Write the data to the dataset
-    if (H5Dwrite(dataset_id, data_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data) < 0) {
-        H5Dclose(dataset_id);
-        H5Sclose(dataspace_id);
-        H5Fclose(file_id);
-        throw std::runtime_error("Error writing data to dataset");
+template <typename T>
+void Reader::WriteResultSlab(T *data, int _howmany, const char *file_name, int load_idx, int time_idx, const char *name)
+{
+    if (results_layout == "time_series") {
+        Results(file_name).AppendSlab(data, _howmany, result_path(load_idx, time_idx, name), time_idx, result_steps(load_idx));
+    } else {
+        Results(file_name).WriteSlab(data, _howmany, result_path(load_idx, time_idx, name));
     }
-
-    // Close the dataset and the file
-    H5Dclose(dataset_id);
-    H5Sclose(dataspace_id);
-    H5Fclose(file_id);
 }
 
-// this function has to be here because of the template
-/* ---------------------------------------------------------------------------
- * Write a 4-D slab (local_n0 × Ny × Nz × howmany) from THIS MPI rank into an
- * HDF5 dataset whose global layout on disk is
- *
- *            Z  Y  X  k   (i.e. "zyx" + extra dim k)
- *
- * The caller supplies the data in logical order
- *            X  Y  Z  k .
- *
- * We therefore transpose in-memory once per write call.
- * --------------------------------------------------------------------------*/
 template <typename T>
-void Reader::WriteSlab(
-    T          *data,     // in:  local slab, layout [X][Y][Z][k]
-    int         _howmany, // global size of the 4th axis (k)
-    const char *file_name,
-    const char *dset_name)
+void Reader::WriteResultData(T *data, const char *file_name, int load_idx, int time_idx, const char *name, hsize_t *dims, int rank)
 {
-    /*------------------------------------------------------------------*/
-    /* 0. map C++ type -> native HDF5 type                              */
-    /*------------------------------------------------------------------*/
-    hid_t data_type;
-    if (std::is_same<T, double>())
-        data_type = H5T_NATIVE_DOUBLE;
-    else if (std::is_same<T, float>())
-        data_type = H5T_NATIVE_FLOAT;
-    else if (std::is_same<T, unsigned char>())
-        data_type = H5T_NATIVE_UCHAR;
-    else if (std::is_same<T, int>())
-        data_type = H5T_NATIVE_INT;
-    else if (std::is_same<T, unsigned short>())
-        data_type = H5T_NATIVE_USHORT;
-    else
-        throw std::invalid_argument("WriteSlab: unsupported data type");
-
-    /*------------------------------------------------------------------*/
-    /* 1. open or create the HDF5 file                                  */
-    /*------------------------------------------------------------------*/
-    hid_t plist_id = H5Pcreate(H5P_FILE_ACCESS);
-    // H5Pset_fapl_mpio(plist_id, comm, info);   /* if you need MPI-IO */
-
-    /* temporarily silence “file not found” during H5Fopen */
-    herr_t (*old_func)(hid_t, void *);
-    void *old_client_data;
-    H5Eget_auto(H5E_DEFAULT, &old_func, &old_client_data);
-    H5Eset_auto(H5E_DEFAULT, nullptr, nullptr);
-
-    hid_t file_id = H5Fopen(file_name, H5F_ACC_RDWR, plist_id);
-    H5Eset_auto(H5E_DEFAULT, old_func, old_client_data); /* restore */
-    if (file_id < 0)                                     /* create if absent */
-        file_id = H5Fcreate(file_name, H5F_ACC_EXCL, H5P_DEFAULT, plist_id);
-    H5Pclose(plist_id);
-
-    /*------------------------------------------------------------------*/
-    /* 2. create the dataset (global dims =  Z Y X k ) if necessary     */
-    /*------------------------------------------------------------------*/
-    const hsize_t Nx   = static_cast<hsize_t>(dims[0]);
-    const hsize_t Ny   = static_cast<hsize_t>(dims[1]);
-    const hsize_t Nz   = static_cast<hsize_t>(dims[2]);
-    const hsize_t kDim = static_cast<hsize_t>(_howmany);
-
-    const int rank        = 4;
-    hsize_t   dimsf[rank] = {Nz, Ny, Nx, kDim}; /* <<< Z Y X k */
-
-    safe_create_group(file_id, dset_name);
-
-    /* silence “dataset not found” during open */
-    H5Eget_auto(H5E_DEFAULT, &old_func, &old_client_data);
-    H5Eset_auto(H5E_DEFAULT, nullptr, nullptr);
-
-    hid_t dset_id = H5Dopen2(file_id, dset_name, H5P_DEFAULT);
-    H5Eset_auto(H5E_DEFAULT, old_func, old_client_data); /* restore */
-
-    if (dset_id < 0) {
-        hid_t filespace = H5Screate_simple(rank, dimsf, nullptr);
-        dset_id         = H5Dcreate2(file_id, dset_name, data_type,
-                                     filespace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        H5Sclose(filespace);
-
-        /*--------------------------------------------------------------*/
-        /*  add the attribute  permute_order = "zyx"                    */
-        /*--------------------------------------------------------------*/
-        const char perm_str[] = "zyx";
-        hid_t      atype      = H5Tcopy(H5T_C_S1);
-        H5Tset_size(atype, 4); /* 3 chars + '\0' */
-        hid_t aspace = H5Screate(H5S_SCALAR);
-        hid_t attr   = H5Acreate2(dset_id, "permute_order",
-                                  atype, aspace, H5P_DEFAULT, H5P_DEFAULT);
-        H5Awrite(attr, atype, perm_str);
-        H5Aclose(attr);
-        H5Sclose(aspace);
-        H5Tclose(atype);
+    if (results_layout == "time_series") {
+        Results(file_name).AppendData(data, result_path(load_idx, time_idx, name), dims, rank, time_idx, result_steps(load_idx));
+    } else {
+        Results(file_name).WriteData(data, result_path(load_idx, time_idx, name), dims, rank);
     }
-
-    /*------------------------------------------------------------------*/
-    /* 3. build FILE hyperslab  (slice along file-dim 2 = X axis)       */
-    /*------------------------------------------------------------------*/
-    hsize_t fcount[4]  = {Nz, Ny, static_cast<hsize_t>(local_n0), kDim};
-    hsize_t foffset[4] = {0, 0, static_cast<hsize_t>(local_0_start), 0};
-
-    hid_t filespace = H5Dget_space(dset_id);
-    H5Sselect_hyperslab(filespace, H5S_SELECT_SET, foffset, nullptr, fcount, nullptr);
-
-    /*------------------------------------------------------------------*/
-    /* 4. transpose local slab  [X][Y][Z][k]  ->  [Z][Y][X][k]          */
-    /*------------------------------------------------------------------*/
-    const size_t NxLoc = static_cast<size_t>(local_n0);
-    const size_t NyLoc = static_cast<size_t>(Ny);
-    const size_t NzLoc = static_cast<size_t>(Nz);
-    const size_t kLoc  = static_cast<size_t>(kDim);
-
-    size_t         slabElems = NxLoc * NyLoc * NzLoc * kLoc;
-    std::vector<T> tmp(slabElems); /* automatic RAII buffer */
-
-    for (size_t x = 0; x < NxLoc; ++x)
-        for (size_t y = 0; y < NyLoc; ++y)
-            for (size_t z = 0; z < NzLoc; ++z) {
-                size_t srcBase = (((x * NyLoc) + y) * NzLoc + z) * kLoc; /* X-major */
-                size_t dstBase = (((z * NyLoc) + y) * NxLoc + x) * kLoc; /* Z-major */
-                std::memcpy(&tmp[dstBase], &data[srcBase], kLoc * sizeof(T));
-            }
-
-    /*------------------------------------------------------------------*/
-    /* 5. MEMORY dataspace matches FILE slab exactly                    */
-    /*------------------------------------------------------------------*/
-    hid_t memspace = H5Screate_simple(4, fcount, nullptr);
-
-    plist_id = H5Pcreate(H5P_DATASET_XFER);
-    // H5Pset_dxpl_mpio(plist_id, H5FD_MPIO_COLLECTIVE);
-
-    herr_t status = H5Dwrite(dset_id, data_type,
-                             memspace, filespace, plist_id, tmp.data());
-    if (status < 0)
-        throw std::runtime_error("WriteSlab: H5Dwrite failed");
-
-    /*------------------------------------------------------------------*/
-    /* 6. tidy up                                                       */
-    /*------------------------------------------------------------------*/
-    H5Sclose(memspace);
-    H5Sclose(filespace);
-    H5Pclose(plist_id);
-    H5Dclose(dset_id);
-    H5Fclose(file_id);
 }
 
 #endif
@@ -0,0 +1,201 @@
+#ifndef RESULTSWRITER_H
+#define RESULTSWRITER_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "hdf5.h"
+#include "mpi.h"
+#include "timer.h"
+
+using namespace std;
+
+/* ---------------------------------------------------------------------------
+ * Results file of a run. The file stays open until Close() (or the
+ * destruction of the writer), the groups that were created once are
+ * remembered, and the datasets of the time series stay open as well, so a
+ * time step only writes its data.
+ *
+ * Fields are local slabs in the logical order [X][Y][Z][k] and are stored as
+ * [Z][Y][X][k] (attribute permute_order = "zyx"). Time series have the time
+ * step as additional leading dimension which is extendible; they are
+ * preallocated to the number of steps of the load case and chunked such that
+ * the chunks of a field align with the x-slabs of the processes. A time step
+ * is then a single hyperslab write of fully overwritten chunks.
+ *
+ * All methods are collective. With parallel HDF5 every process keeps the
+ * file open and writes its slab through MPI-IO, otherwise rank 0 keeps the
+ * file open and writes the slabs it receives from the other processes.
+ * --------------------------------------------------------------------------*/
+class ResultsWriter {
+  public:
+    ResultsWriter(const string &file_name, const vector<int> &dims, ptrdiff_t local_n0, ptrdiff_t local_0_start);
+    ~ResultsWriter();
+
+    ResultsWriter(const ResultsWriter &)            = delete;
+    ResultsWriter &operator=(const ResultsWriter &) = delete;
+
+    const string file_name;
+
+    // Field dset_name, an existing dataset of the same shape is overwritten
+    template <typename T>
+    void WriteSlab(const T *data, int howmany, const string &dset_name);
+
+    // Data replicated on all processes (written by rank 0), an existing dataset is replaced
+    template <typename T>
+    void WriteData(const T *data, const string &dset_name, const hsize_t *dims, int rank);
+
+    // Step time_idx of the time series dset_name, which is created with n_steps steps on first use in this run
+    template <typename T>
+    void AppendSlab(const T *data, int howmany, const string &dset_name, hsize_t time_idx, hsize_t n_steps);
+
+    // Data of a time series may change its shape between the steps (e.g. absolute_error), the dataset is
+    // extended and the entries which are not written read as NaN
+    template <typename T>
+    void AppendData(const T *data, const string &dset_name, const hsize_t *dims, int rank, hsize_t time_idx, hsize_t n_steps);
+
+    void Flush();
+    void Close();
+
+  private:
+    struct Series {
+        hid_t           dset;
+        vector<hsize_t> extent;
+    };
+
+    hid_t file = -1; // -1 on the processes which do not write
+    int   world_rank;
+    int   world_size;
+
+    hsize_t             Nx, Ny, Nz;
+    vector<long long>   slab_n0;      // local_n0 of all processes
+    vector<long long>   slab_0_start; // local_0_start of all processes
+    set<string>         groups;       // groups known to exist
+    map<string, Series> series;       // open datasets of the time series
+
+    template <typename T>
+    static hid_t h5_type();
+
+    bool  writes() const { return file >= 0; }
+    void  create_groups(const string &dset_name);
+    hid_t open_field(const string &dset_name, hid_t data_type, int howmany);
+    hid_t open_series(const string &dset_name, hid_t data_type, const vector<hsize_t> &step_dims, hsize_t time_idx, hsize_t n_steps, bool field);
+    void  write_hyperslab(hid_t dset, hid_t data_type, const void *buf, int rank, const hsize_t *offset, const hsize_t *count, bool contribute);
+    void  write_field(hid_t dset, hid_t data_type, const void *buf, ptrdiff_t x_start, ptrdiff_t n_x, int howmany, const hsize_t *time_idx);
+
+    template <typename T>
+    void write_slab(hid_t dset, const T *data, int howmany, const hsize_t *time_idx);
+};
+
+template <typename T>
+hid_t ResultsWriter::h5_type()
+{
+    if (std::is_same<T, double>())
+        return H5T_NATIVE_DOUBLE;
+    else if (std::is_same<T, float>())
+        return H5T_NATIVE_FLOAT;
+    else if (std::is_same<T, unsigned char>())
+        return H5T_NATIVE_UCHAR;
+    else if (std::is_same<T, int>())
+        return H5T_NATIVE_INT;
+    else if (std::is_same<T, unsigned short>())
+        return H5T_NATIVE_USHORT;
+    throw std::invalid_argument("ResultsWriter: unsupported data type");
+}
+
+// Transposes the local slab [X][Y][Z][k] into the file order [Z][Y][X][k] and writes it. Without parallel HDF5 the
+// other processes send their transposed slab to rank 0, which writes them one after another.
+template <typename T>
+void ResultsWriter::write_slab(hid_t dset, const T *data, int howmany, const hsize_t *time_idx)
+{
+    const size_t nx = slab_n0[world_rank];
+    const size_t ny = Ny;
+    const size_t nz = Nz;
+    const size_t k  = howmany;
+
+    vector<T> tmp(nx * ny * nz * k);
+    for (size_t x = 0; x < nx; ++x)
+        for (size_t y = 0; y < ny; ++y)
+            for (size_t z = 0; z < nz; ++z)
+                std::memcpy(&tmp[((z * ny + y) * nx + x) * k], &data[((x * ny + y) * nz + z) * k], k * sizeof(T));
+
+#ifdef H5_HAVE_PARALLEL
+    write_field(dset, h5_type<T>(), tmp.data(), slab_0_start[world_rank], nx, howmany, time_idx);
+#else
+    MPI_Datatype element;
+    MPI_Type_contiguous(sizeof(T), MPI_BYTE, &element);
+    MPI_Type_commit(&element);
+    if (world_rank == 0) {
+        write_field(dset, h5_type<T>(), tmp.data(), slab_0_start[0], nx, howmany, time_idx);
+        for (int i = 1; i < world_size; ++i) {
+            tmp.resize(slab_n0[i] * ny * nz * k);
+            MPI_Recv(tmp.data(), tmp.size(), element, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            write_field(dset, h5_type<T>(), tmp.data(), slab_0_start[i], slab_n0[i], howmany, time_idx);
+        }
+    } else {
+        MPI_Send(tmp.data(), tmp.size(), element, 0, 0, MPI_COMM_WORLD);
+    }
+    MPI_Type_free(&element);
+#endif
+}
+
+template <typename T>
+void ResultsWriter::WriteSlab(const T *data, int howmany, const string &dset_name)
+{
+    TimedRegion timed("hdf5_write");
+    hid_t       dset = writes() ? open_field(dset_name, h5_type<T>(), howmany) : -1;
+    write_slab(dset, data, howmany, nullptr);
+    if (writes())
+        H5Dclose(dset);
+}
+
+template <typename T>
+void ResultsWriter::WriteData(const T *data, const string &dset_name, const hsize_t *dims, int rank)
+{
+    TimedRegion timed("hdf5_write");
+    if (!writes())
+        return;
+    create_groups(dset_name);
+    if (H5Lexists(file, dset_name.c_str(), H5P_DEFAULT) > 0)
+        H5Ldelete(file, dset_name.c_str(), H5P_DEFAULT);
+
+    hid_t dataspace = H5Screate_simple(rank, dims, nullptr);
+    hid_t dset      = H5Dcreate2(file, dset_name.c_str(), h5_type<T>(), dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    H5Sclose(dataspace);
+    if (dset < 0)
+        throw std::runtime_error("ResultsWriter: could not create the dataset " + dset_name);
+
+    // With MPI-IO the write is collective but only rank 0 contributes data
+    vector<hsize_t> offset(rank, 0);
+    write_hyperslab(dset, h5_type<T>(), data, rank, offset.data(), dims, world_rank == 0);
+    H5Dclose(dset);
+}
+
+template <typename T>
+void ResultsWriter::AppendSlab(const T *data, int howmany, const string &dset_name, hsize_t time_idx, hsize_t n_steps)
+{
+    TimedRegion timed("hdf5_write");
+    hid_t       dset = -1;
+    if (writes()) {
+        dset = open_series(dset_name, h5_type<T>(), {Nz, Ny, Nx, static_cast<hsize_t>(howmany)}, time_idx, n_steps, true);
+    }
+    write_slab(dset, data, howmany, &time_idx);
+}
+
+template <typename T>
+void ResultsWriter::AppendData(const T *data, const string &dset_name, const hsize_t *dims, int rank, hsize_t time_idx, hsize_t n_steps)
+{
+    TimedRegion timed("hdf5_write");
+    if (!writes())
+        return;
+    hid_t dset = open_series(dset_name, h5_type<T>(), vector<hsize_t>(dims, dims + rank), time_idx, n_steps, false);
+
+    vector<hsize_t> offset(rank + 1, 0);
+    vector<hsize_t> count(rank + 1, 1);
+    offset[0] = time_idx;
+    std::copy(dims, dims + rank, count.begin() + 1);
+    write_hyperslab(dset, h5_type<T>(), data, rank + 1, offset.data(), count.data(), world_rank == 0);
+}
+
+#endif
@@ -1,5 +1,10 @@
 #include "solverCG.h"
+#include "solverCGPipelined.h"
 #include "solverFP.h"
+#include "solverFPAnderson.h"
+#include "solverNewtonCG.h"
+#include "solverPolarization.h"
+#include "solverTangent.h"
 
 // Thermal models
 #include "material_models/LinearThermal.h"
@@ -53,13 +58,50 @@ Matmodel<3> *createMatmodel(const Reader &reader)
     }
 }
 
-template <int howmany>
-Solver<howmany> *createSolver(const Reader &reader, Matmodel<howmany> *matmodel)
+// FFTW has to know about threads before its MPI interface is initialized, see https://fftw.org/doc/Combining-MPI-and-Threads.html
+inline void initializeFFTW()
+{
+#ifdef FANS_FFTW_THREADS
+    fftw_init_threads();
+#endif
+    fftw_mpi_init();
+#ifdef FANS_SINGLE_PRECISION
+#ifdef FANS_FFTW_THREADS
+    fftwf_init_threads();
+#endif
+    fftwf_mpi_init();
+#endif
+}
+
+// Number of threads used by the element loops and by all FFTW plans created afterwards
+inline void setNumThreads(const Reader &reader)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(reader.n_threads);
+#endif
+#ifdef FANS_FFTW_THREADS
+    fftw_plan_with_nthreads(reader.n_threads);
+#ifdef FANS_SINGLE_PRECISION
+    fftwf_plan_with_nthreads(reader.n_threads);
+#endif
+#endif
+}
+
+template <int howmany, typename real_t = double>
+Solver<howmany, real_t> *createSolver(const Reader &reader, Matmodel<howmany> *matmodel)
 {
     if (reader.method == "fp") {
-        return new SolverFP<howmany>(reader, matmodel);
+        return new SolverFP<howmany, real_t>(reader, matmodel);
     } else if (reader.method == "cg") {
-        return new SolverCG<howmany>(reader, matmodel);
+        return new SolverCG<howmany, real_t>(reader, matmodel);
+    } else if (reader.method == "cg_pipelined") {
+        return new SolverCGPipelined<howmany, real_t>(reader, matmodel);
+    } else if (reader.method == "fp_anderson") {
+        return new SolverFPAnderson<howmany, real_t>(reader, matmodel);
+    } else if (reader.method == "newton_cg") {
+        return new SolverNewtonCG<howmany, real_t>(reader, matmodel);
+    } else if (reader.method == "eyre_milton" || reader.method == "admm") {
+        return new SolverPolarization<howmany, real_t>(reader, matmodel);
     } else {
         throw std::invalid_argument(reader.method + " is not a valid method");
     }
@@ -2,14 +2,27 @@
 #define SOLVER_H
 
 #include "matmodel.h"
+#include "fftw_traits.h"
+#include "timer.h"
 
-typedef Map<Array<double, Dynamic, Dynamic>, Unaligned, OuterStride<>> RealArray;
+template <int howmany, typename real_t>
+class TangentSolver;
 
-template <int howmany>
+/**
+ * @brief FFT-based solver on the voxel grid of the microstructure.
+ *
+ * real_t is the scalar type of the fields and of the FFTs (double or float). The material models always work in double
+ * precision, the element displacements and residuals are converted in compute_residual_basic.
+ */
+
+template <int howmany, typename real_t = double>
 class Solver : private MixedBCController<howmany> {
   public:
+    typedef Map<Array<real_t, Dynamic, Dynamic>, Unaligned, OuterStride<>> RealArray;
+    typedef Matrix<std::complex<real_t>, Dynamic, 1>                     ComplexVector;
+
     Solver(Reader reader, Matmodel<howmany> *matmodel);
-    virtual ~Solver() = default;
+    virtual ~Solver();
 
     Reader reader;
 
@@ -29,24 +42,69 @@ class Solver : private MixedBCController<howmany> {
     Matmodel<howmany> *matmodel; //!< Material Model
 
     unsigned short *ms;  // Micro-structure
-    double         *v_r; //!< Residual vector
-    double         *v_u;
-    double         *buffer_padding;
+    real_t         *v_r; //!< Residual vector
+    real_t         *v_u;
+    real_t         *buffer_padding;
+
+    RealArray          v_r_real; // can't do the "classname()" intialization here, and Map doesn't have a default constructor
+    RealArray          v_u_real;
+    Map<ComplexVector> rhat;
 
-    RealArray      v_r_real; // can't do the "classname()" intialization here, and Map doesn't have a default constructor
-    RealArray      v_u_real;
-    Map<VectorXcd> rhat;
+    ArrayXd                          err_all;             //!< Absolute error history
+    Matrix<real_t, howmany, Dynamic> fundamentalSolution; //!< Tabulated Green operator, empty if it is evaluated on the fly
+    const bool                       accumulate_double;   //!< Reductions of float fields are summed up in double ("precision": "mixed")
 
-    ArrayXd                          err_all; //!< Absolute error history
-    Matrix<double, howmany, Dynamic> fundamentalSolution;
+    bool                                  green_on_the_fly;    //!< Recompute the Green operator in every convolution instead of storing it
+    vector<complex<double>>               eta_x, eta_y, eta_z; //!< Per-axis factors exp(2*pi*i*k/n) of the local Fourier modes
+    Matrix<double, 14, howmany * howmany> Ker0_offsets;        //!< Reference stiffness summed up per node offset, see constructor
+    Matrix<double, howmany, howmany>      greenBlock(ptrdiff_t i_x, ptrdiff_t i_y, ptrdiff_t i_z) const;
 
     template <int padding, typename F>
     void iterateCubes(F f);
+    template <int padding, typename F>
+    void iterateCubes(F f, ptrdiff_t x_begin, ptrdiff_t x_end); //!< Elements of the x-planes [x_begin, x_end) only
+    template <int padding, typename F>
+    void iterateCubesColored(F f, bool parallel = true); //!< iterateCubes in colored order, f has to be reentrant if parallel
+    template <int padding, typename F>
+    void iterateCubesColored(F f, ptrdiff_t x_begin, ptrdiff_t x_end, bool parallel);
+    template <int padding, typename F>
+    void iterateCubesByPhase(F f, bool parallel); //!< Element loop over the phase-sorted element lists
+    template <int padding, typename F>
+    void iterateCubesByPhase(F f, bool parallel, int part); //!< Phase-sorted elements of one part of the slab
+
+    // Parts of the local slab in the order of the element loop of assembleWithHalo: the interior planes need neither
+    // the ghost plane of the input nor write the plane sent to the next process, the last plane needs the ghost plane
+    // and writes the sent plane, the first plane is assembled while the sent plane is in flight
+    static const int interior_planes = 0, last_plane = 1, first_plane = 2, n_slab_parts = 3;
+    void             slabPartPlanes(int part, ptrdiff_t &x_begin, ptrdiff_t &x_end) const;
+    template <int padding, typename F>
+    void iterateSlabPart(int part, F f, bool parallel); //!< Element loop over one part of the slab, see compute_residual_basic
+    template <int padding, typename F>
+    void assembleWithHalo(real_t *in, ptrdiff_t in_plane, real_t *out, ptrdiff_t out_plane, real_t *buffer, F f, bool parallel);
+
+    const bool        phase_sorted;          //!< Element loops run phase by phase ("phase_sorted_elements")
+    int               n_phase_colors = 1;    //!< Number of colors of the phase-sorted element lists
+    int               n_phases       = 0;    //!< Number of phase indices of the local elements (max(ms) + 1)
+    vector<ptrdiff_t> phase_elements;        //!< Local element indices sorted by part of the slab, color, phase and position
+    vector<ptrdiff_t> phase_element_offsets; //!< Start of the elements of (part, color, phase), see buildPhaseElementLists
+    void              buildPhaseElementLists();
 
     void         solve();
+    void         updateInternalVariables(); //!< Makes the converged state the history, done by the next solve()
+    bool         history_pending = false;   //!< The internal variables of the last solve() are not the history yet
+    void         reset(); //!< Prepares a new load case, keeps the Green operator and the FFTW plans
+    void         predict(const string &predictor, size_t time_idx); //!< Initial guess of v_u for a time step
+    void         buildGreenOperator();       //!< Green operator of the current kapparef_mat
+    void         updateReferenceMedium();    //!< "reference_medium": "adaptive", see solve()
+    MatrixXd     initial_reference;          //!< kapparef_mat after the constructor, restored by reset()
+    virtual void referenceMediumChanged() {} //!< Called after kapparef_mat and the Green operator changed
     virtual void internalSolve() {}; // important to have "{}" here, otherwise we get an error about undefined reference to vtable
+    virtual bool residualAtSolution() const //!< The last compute_residual of internalSolve is evaluated at the returned v_u
+    {
+        return false;
+    }
 
-    template <int padding, typename F>
+    template <int padding, bool reentrant = false, typename F>
     void compute_residual_basic(RealArray &r_matrix, RealArray &u_matrix, F f);
     template <int padding>
     void compute_residual(RealArray &r_matrix, RealArray &u_matrix);
@@ -55,13 +113,18 @@ class Solver : private MixedBCController<howmany> {
 
     void   convolution();
     double compute_error(RealArray &r);
-    void   CreateFFTWPlans(double *in, fftw_complex *transformed, double *out);
+    double compute_error(double err);         //!< Same for the norm of the residual evaluated by the caller
+    double residual_norm(RealArray &r);       //!< Norm of r in the measure of "error_parameters", collective
+    double local_residual_norm(RealArray &r); //!< Contribution of this process, reduced with MPI_MAX
+    void   CreateFFTWPlans(real_t *in, typename FFTWTraits<real_t>::complex *transformed, real_t *out);
 
     VectorXd homogenized_stress;
+    bool     homogenized_stress_current = false; //!< homogenized_stress belongs to v_u, kept by solve() for postprocess
     VectorXd get_homogenized_stress();
 
-    MatrixXd homogenized_tangent;
-    MatrixXd get_homogenized_tangent(double pert_param);
+    MatrixXd                        homogenized_tangent;
+    MatrixXd                        get_homogenized_tangent(double pert_param);
+    TangentSolver<howmany, real_t> *tangent_solver = nullptr; //!< Batched solver of get_homogenized_tangent, created on first use
 
     void enableMixedBC(const MixedBC &mbc, size_t step)
     {
@@ -79,15 +142,35 @@ class Solver : private MixedBCController<howmany> {
     {
         this->update(*this);
     }
+    void updateMixedBCPolarization(const VectorXd &y_mean, double c)
+    {
+        this->update_polarization(*this, y_mean, c);
+    }
 
   protected:
-    fftw_plan planfft, planifft;
-    clock_t   fft_time, buftime;
-    size_t    iter;
+    typename FFTWTraits<real_t>::plan planfft, planifft;
+    double                            fft_time, buftime; // wall-clock seconds
+    size_t                            iter;
+
+    Array<real_t, Dynamic, Dynamic> u_prev[2];     //!< Converged fluctuations of the last time steps for predict()
+    int                             n_history = 0; //!< Number of valid entries of u_prev
+
+    MatrixXd          stress_sums;          //!< Stresses at the Gauss points summed up per work unit, see resetStressSums
+    vector<double>    stress_sums_gradient; //!< Macroscale gradient of stress_sums, empty if they are outdated
+    vector<ptrdiff_t> work_unit;            //!< Work unit of the element loop per thread, one cache line per thread
+    void           resetStressSums();
+    template <int n_str>
+    void     addStressSums(const Matrix<double, n_str * 8, 1> &sigma);
+    VectorXd averageStressSums(); //!< Volume average of the stress summed up in stress_sums, collective
+
+    template <int padding, typename F>
+    void iterateLine(ptrdiff_t i_x, ptrdiff_t i_y, F &f);
+    template <int padding>
+    void elementNodes(ptrdiff_t element, ptrdiff_t *idx, ptrdiff_t *idxPadding) const;
 };
 
-template <int howmany>
-Solver<howmany>::Solver(Reader reader, Matmodel<howmany> *mat)
+template <int howmany, typename real_t>
+Solver<howmany, real_t>::Solver(Reader reader, Matmodel<howmany> *mat)
     : reader(reader),
       matmodel(mat),
       world_rank(reader.world_rank),
@@ -104,83 +187,207 @@ Solver<howmany>::Solver(Reader reader, Matmodel<howmany> *mat)
       TOL(reader.TOL),
       ms(reader.ms),
 
-      v_r(fftw_alloc_real(std::max(reader.alloc_local * 2, (local_n0 + 1) * n_y * (n_z + 2) * howmany))),
+      v_r(FFTWTraits<real_t>::alloc_real(std::max(reader.alloc_local * 2, (local_n0 + 1) * n_y * (n_z + 2) * howmany))),
       v_r_real(v_r, n_z * howmany, local_n0 * n_y, OuterStride<>((n_z + 2) * howmany)),
 
-      v_u(fftw_alloc_real((local_n0 + 1) * n_y * n_z * howmany)),
+      v_u(FFTWTraits<real_t>::alloc_real((local_n0 + 1) * n_y * n_z * howmany)),
       v_u_real(v_u, n_z * howmany, local_n0 * n_y, OuterStride<>(n_z * howmany)),
 
-      rhat((std::complex<double> *) v_r, local_n1 * n_x * (n_z / 2 + 1) * howmany), // actual initialization is below
-      buffer_padding(fftw_alloc_real(n_y * (n_z + 2) * howmany))
+      rhat((std::complex<real_t> *) v_r, local_n1 * n_x * (n_z / 2 + 1) * howmany), // actual initialization is below
+      buffer_padding(FFTWTraits<real_t>::alloc_real(n_y * (n_z + 2) * howmany)),
+      accumulate_double(reader.precision == "mixed"),
+      phase_sorted(reader.phase_sorted_elements),
+      work_unit(8 * maxThreads(), 0)
 {
-    v_u_real.setZero();
-    for (ptrdiff_t i = local_n0 * n_y * n_z * howmany; i < (local_n0 + 1) * n_y * n_z * howmany; i++) {
-        this->v_u[i] = 0;
+    reset();
+    if (phase_sorted) {
+        buildPhaseElementLists();
     }
 
-    matmodel->initializeInternalVariables(local_n0 * n_y * n_z, 8);
+    if (reader.reference_medium != "mean") {
+        const Vector2d bounds = matmodel->relative_stiffness_bounds(matmodel->initial_stiffness());
+        matmodel->kapparef_mat *= 0.5 * (bounds(0) + bounds(1));
+        if (world_rank == 0) {
+            printf("# Reference medium scaled by %f to the midpoint of the phase stiffness bounds\n", 0.5 * (bounds(0) + bounds(1)));
+        }
+    }
+    initial_reference = matmodel->kapparef_mat;
+    buildGreenOperator();
+}
 
+template <int howmany, typename real_t>
+Solver<howmany, real_t>::~Solver()
+{
+    delete tangent_solver;
+}
+
+template <int howmany, typename real_t>
+void Solver<howmany, real_t>::buildGreenOperator()
+{
     if (world_rank == 0) {
         printf("\n# Start creating Fundamental Solution(s) \n");
     }
-    clock_t tot_time = clock();
+    TimedRegion timed("green_operator_setup");
 
     Matrix<double, howmany * 8, howmany * 8> Ker0 = matmodel->Compute_Reference_ElementStiffness();
 
     complex<double> tpi = 2 * acos(-1) * complex<double>(0, 1); //=2*pi*i
 
-    auto etax = [&](double i) { return exp(tpi * i / (double) n_x); };
-    auto etay = [&](double i) { return exp(tpi * i / (double) n_y); };
-    auto etaz = [&](double i) { return exp(tpi * i / (double) n_z); };
-
-    Matrix<complex<double>, 8, 1>    A;
-    Matrix<double, 8, 8>             AA;
-    Matrix<double, howmany, howmany> block;
-    fundamentalSolution = Matrix<double, howmany, Dynamic>(howmany, (local_n1 * n_x * (n_z / 2 + 1) * (howmany + 1)) / 2);
-    fundamentalSolution.setZero();
-
-    for (int i_y = 0; i_y < local_n1; ++i_y) {
-        for (int i_x = 0; i_x < n_x; ++i_x) {
-            for (int i_z = 0; i_z < n_z / 2 + 1; ++i_z) {
-                if (i_x != 0 || (local_1_start + i_y) != 0 || i_z != 0) {
-
-                    A(0, 0) = 1.0;
-                    A(1, 0) = etax(i_x);
-                    A(2, 0) = etay(local_1_start + i_y);
-                    A(3, 0) = etax(i_x) * etay(local_1_start + i_y);
-                    A(4, 0) = etaz(i_z);
-                    A(5, 0) = etax(i_x) * etaz(i_z);
-                    A(6, 0) = etaz(i_z) * etay(local_1_start + i_y);
-                    A(7, 0) = etax(i_x) * etay(local_1_start + i_y) * etaz(i_z);
-                    AA      = A.real() * A.real().transpose() + A.imag() * A.imag().transpose();
-
-                    for (int i = 0; i < howmany; i++) {
-                        for (int j = i; j < howmany; j++) {
-                            block(i, j) = (Ker0.template block<8, 8>(8 * i, 8 * j).array() * AA.array()).sum();
-                            block(j, i) = block(i, j); // we'd like to avoid this, but block.selfadjointView<Upper>().inverse() does not work
-                        }
+    eta_x.resize(n_x);
+    eta_y.resize(local_n1);
+    eta_z.resize(n_z / 2 + 1);
+    for (ptrdiff_t i = 0; i < n_x; ++i) {
+        eta_x[i] = exp(tpi * (double) i / (double) n_x);
+    }
+    for (ptrdiff_t i = 0; i < local_n1; ++i) {
+        eta_y[i] = exp(tpi * (double) (local_1_start + i) / (double) n_y);
+    }
+    for (ptrdiff_t i = 0; i < n_z / 2 + 1; ++i) {
+        eta_z[i] = exp(tpi * (double) i / (double) n_z);
+    }
+
+    green_on_the_fly = (reader.green_operator == "on_the_fly");
+    if (green_on_the_fly) {
+        // A*A^H only depends on the offset between the two element nodes, so Ker0 is summed up over all node pairs with
+        // the same offset. Opposite offsets give the same (real) contribution and are merged as well, leaving 14 offsets.
+        // The scaling by 1/n_el of the tabulated version is moved into the kernel.
+        Ker0_offsets.setZero();
+        for (int a = 0; a < 8; ++a) {
+            for (int b = 0; b < 8; ++b) {
+                int d = ((a & 1) - (b & 1) + 1) + 3 * (((a >> 1) & 1) - ((b >> 1) & 1) + 1) + 9 * (((a >> 2) & 1) - ((b >> 2) & 1) + 1);
+                d     = std::max(d, 26 - d) - 13;
+                for (int i = 0; i < howmany; ++i) {
+                    for (int j = 0; j < howmany; ++j) {
+                        Ker0_offsets(d, i + howmany * j) += Ker0(8 * i + a, 8 * j + b) * (double) (n_x * n_y * n_z);
                     }
-                    ptrdiff_t ind = i_y * n_x * (n_z / 2 + 1) + i_x * (n_z / 2 + 1) + i_z;
-                    if (ind % 2 == 0) {
-                        fundamentalSolution.template middleCols<howmany>((ind / 2) * (howmany + 1)).template triangularView<Lower>() = block.inverse().template triangularView<Lower>();
-                    } else {
-                        fundamentalSolution.template middleCols<howmany>((ind / 2) * (howmany + 1) + 1).template triangularView<Upper>() = block.inverse().template triangularView<Upper>();
+                }
+            }
+        }
+    } else {
+        Matrix<complex<double>, 8, 1>    A;
+        Matrix<double, 8, 8>             AA;
+        Matrix<double, howmany, howmany> block;
+        fundamentalSolution = Matrix<real_t, howmany, Dynamic>(howmany, (local_n1 * n_x * (n_z / 2 + 1) * (howmany + 1)) / 2);
+        fundamentalSolution.setZero();
+
+        for (int i_y = 0; i_y < local_n1; ++i_y) {
+            for (int i_x = 0; i_x < n_x; ++i_x) {
+                for (int i_z = 0; i_z < n_z / 2 + 1; ++i_z) {
+                    if (i_x != 0 || (local_1_start + i_y) != 0 || i_z != 0) {
+
+                        A(0, 0) = 1.0;
+                        A(1, 0) = eta_x[i_x];
+                        A(2, 0) = eta_y[i_y];
+                        A(3, 0) = eta_x[i_x] * eta_y[i_y];
+                        A(4, 0) = eta_z[i_z];
+                        A(5, 0) = eta_x[i_x] * eta_z[i_z];
+                        A(6, 0) = eta_z[i_z] * eta_y[i_y];
+                        A(7, 0) = eta_x[i_x] * eta_y[i_y] * eta_z[i_z];
+                        AA      = A.real() * A.real().transpose() + A.imag() * A.imag().transpose();
+
+                        for (int i = 0; i < howmany; i++) {
+                            for (int j = i; j < howmany; j++) {
+                                block(i, j) = (Ker0.template block<8, 8>(8 * i, 8 * j).array() * AA.array()).sum();
+                                block(j, i) = block(i, j); // we'd like to avoid this, but block.selfadjointView<Upper>().inverse() does not work
+                            }
+                        }
+                        ptrdiff_t ind = i_y * n_x * (n_z / 2 + 1) + i_x * (n_z / 2 + 1) + i_z;
+                        if (ind % 2 == 0) {
+                            fundamentalSolution.template middleCols<howmany>((ind / 2) * (howmany + 1)).template triangularView<Lower>() = block.inverse().template cast<real_t>().template triangularView<Lower>();
+                        } else {
+                            fundamentalSolution.template middleCols<howmany>((ind / 2) * (howmany + 1) + 1).template triangularView<Upper>() = block.inverse().template cast<real_t>().template triangularView<Upper>();
+                        }
                     }
                 }
             }
         }
+        // // Divided by n_el to scale the Fundamental solution so explicit normalization is not needed for FFT and IFFT
+        fundamentalSolution /= (real_t) (n_x * n_y * n_z);
     }
-    // // Divided by n_el to scale the Fundamental solution so explicit normalization is not needed for FFT and IFFT
-    fundamentalSolution /= (double) (n_x * n_y * n_z);
 
-    tot_time = clock() - tot_time;
     if (world_rank == 0) {
-        printf("# Complete; Time for construction of Fundamental Solution(s): %f seconds\n", double(tot_time) / CLOCKS_PER_SEC);
+        printf("# Complete; Time for construction of Fundamental Solution(s): %f seconds\n", timed.elapsed());
+    }
+}
+
+// Block of the Green operator for the local Fourier mode (i_x, i_y, i_z), computed from the per-axis factors. The real
+// part of eta_x^dx * eta_y^dy * eta_z^dz is the weight of the node offset (dx, dy, dz) in the reduced kernel.
+template <int howmany, typename real_t>
+inline Matrix<double, howmany, howmany> Solver<howmany, real_t>::greenBlock(ptrdiff_t i_x, ptrdiff_t i_y, ptrdiff_t i_z) const
+{
+    const complex<double> ex[3] = {conj(eta_x[i_x]), 1.0, eta_x[i_x]};
+    const complex<double> ey[3] = {conj(eta_y[i_y]), 1.0, eta_y[i_y]};
+    const complex<double> ez[3] = {conj(eta_z[i_z]), 1.0, eta_z[i_z]};
+
+    Matrix<double, 1, howmany * howmany> block = Matrix<double, 1, howmany * howmany>::Zero();
+    for (int d = 13; d < 27; ++d) {
+        block += (ex[d % 3] * ey[(d / 3) % 3] * ez[d / 9]).real() * Ker0_offsets.row(d - 13);
+    }
+    // fixed size inverse, Eigen uses the closed form (cofactors) for howmany <= 4
+    return Map<Matrix<double, howmany, howmany>>(block.data()).inverse();
+}
+
+// Everything that depends on the load history is reset here. The fundamental solution only depends on the
+// microstructure and the reference medium and the FFTW plans only on the grid, so both survive between load cases.
+// Only a reference medium adapted to the last load case ("reference_medium": "adaptive") is set back, which rebuilds
+// the Green operator.
+template <int howmany, typename real_t>
+void Solver<howmany, real_t>::reset()
+{
+    if (initial_reference.size() > 0 && matmodel->kapparef_mat != initial_reference) {
+        matmodel->kapparef_mat = initial_reference;
+        buildGreenOperator();
+        referenceMediumChanged();
+    }
+    v_u_real.setZero();
+    for (ptrdiff_t i = local_n0 * n_y * n_z * howmany; i < (local_n0 + 1) * n_y * n_z * howmany; i++) {
+        this->v_u[i] = 0;
+    }
+
+    matmodel->initializeInternalVariables(local_n0 * n_y * n_z, 8);
+    disableMixedBC();
+    stress_sums_gradient.clear();
+    homogenized_stress_current = false;
+    history_pending            = false;
+}
+
+// Called before every time step, v_u holds the converged fluctuation u_n of the last step. Assuming equidistant load
+// steps, the initial guess is 2 u_n - u_n-1 ("linear") or 3 u_n - 3 u_n-1 + u_n-2 ("quadratic"), with the lower order
+// while the history of the load case is too short.
+template <int howmany, typename real_t>
+void Solver<howmany, real_t>::predict(const string &predictor, size_t time_idx)
+{
+    const int order = (predictor == "quadratic") ? 2 : (predictor == "linear") ? 1 : 0;
+    if (order == 0) {
+        return;
+    }
+    if (time_idx == 0) {
+        n_history = 0;
+        return;
     }
+    TimedRegion timed("predictor");
+    for (int i = 0; i < order; ++i) {
+        u_prev[i].resize(n_z * howmany, local_n0 * n_y);
+    }
+
+    if (n_history == 0) {
+        u_prev[0] = v_u_real;
+    } else if (n_history == 1 || order == 1) {
+        if (order == 2) {
+            u_prev[1] = u_prev[0];
+        }
+        u_prev[0] = (real_t) 2 * v_u_real - u_prev[0];
+        v_u_real.swap(u_prev[0]);
+    } else {
+        u_prev[1] = (real_t) 3 * (v_u_real - u_prev[0]) + u_prev[1];
+        u_prev[1].swap(u_prev[0]);
+        v_u_real.swap(u_prev[0]);
+    }
+    n_history = std::min(n_history + 1, order);
 }
 
-template <int howmany>
-void Solver<howmany>::CreateFFTWPlans(double *in, fftw_complex *transformed, double *out)
+template <int howmany, typename real_t>
+void Solver<howmany, real_t>::CreateFFTWPlans(real_t *in, typename FFTWTraits<real_t>::complex *transformed, real_t *out)
 {
     int       rank   = 3;
     ptrdiff_t iblock = FFTW_MPI_DEFAULT_BLOCK;
@@ -193,206 +400,615 @@ void Solver<howmany>::CreateFFTWPlans(double *in, fftw_complex *transformed, dou
     // so we need to use a different n than for fftw_mpi_local_size_many !
     // But, according to https://fftw.org/doc/MPI-Plan-Creation.html the BLOCK sizes must be the same:
     // "These must be the same block sizes as were passed to the corresponding ‘local_size’ function"
-    const ptrdiff_t n[3] = {n_x, n_y, n_z};
-    planfft              = fftw_mpi_plan_many_dft_r2c(rank, n, howmany, iblock, oblock, in, transformed, MPI_COMM_WORLD, FFTW_MEASURE | FFTW_MPI_TRANSPOSED_OUT);
-    planifft             = fftw_mpi_plan_many_dft_c2r(rank, n, howmany, iblock, oblock, transformed, out, MPI_COMM_WORLD, FFTW_MEASURE | FFTW_MPI_TRANSPOSED_IN);
+    const ptrdiff_t n[3]  = {n_x, n_y, n_z};
+    const unsigned  flags = fftwPlannerFlags(reader.fftw_planner);
+    TimedRegion     timed("fftw_planning");
+
+    // The wisdom of a run is only valid for the same problem on the same number of ranks, so the file name contains both.
+    // Rank 0 reads the file and broadcasts it, see https://fftw.org/doc/FFTW-MPI-Wisdom.html
+    string wisdom_file;
+    if (!reader.fftw_wisdom_dir.empty()) {
+        wisdom_file = reader.fftw_wisdom_dir + "/fftw_wisdom_" + to_string(n_x) + "x" + to_string(n_y) + "x" + to_string(n_z) +
+                      "_howmany" + to_string(howmany) + "_np" + to_string(world_size) + (std::is_same<real_t, float>::value ? "_single" : "") + ".txt";
+        int imported = 0;
+        if (world_rank == 0) {
+            imported = FFTWTraits<real_t>::import_wisdom_from_filename(wisdom_file.c_str());
+            printf("# FFTW wisdom file %s %s\n", wisdom_file.c_str(), imported ? "imported" : "not found, planning from scratch");
+        }
+        FFTWTraits<real_t>::mpi_broadcast_wisdom(MPI_COMM_WORLD);
+    }
+
+    planfft  = FFTWTraits<real_t>::mpi_plan_many_dft_r2c(rank, n, howmany, iblock, oblock, in, transformed, MPI_COMM_WORLD, flags | FFTW_MPI_TRANSPOSED_OUT);
+    planifft = FFTWTraits<real_t>::mpi_plan_many_dft_c2r(rank, n, howmany, iblock, oblock, transformed, out, MPI_COMM_WORLD, flags | FFTW_MPI_TRANSPOSED_IN);
+    if (planfft == NULL || planifft == NULL) {
+        throw std::runtime_error("FFTW could not create the plans" + string(flags == FFTW_WISDOM_ONLY ? ", no wisdom available for this problem (fftw_planner: wisdom_only)" : ""));
+    }
+
+    if (!wisdom_file.empty()) {
+        FFTWTraits<real_t>::mpi_gather_wisdom(MPI_COMM_WORLD);
+        if (world_rank == 0 && !FFTWTraits<real_t>::export_wisdom_to_filename(wisdom_file.c_str())) {
+            fprintf(stderr, "WARNING: Could not write the FFTW wisdom file %s\n", wisdom_file.c_str());
+        }
+    }
 
     // see https://eigen.tuxfamily.org/dox/group__TutorialMapClass.html#title3
-    new (&rhat) Map<VectorXcd>((std::complex<double> *) transformed, local_n1 * n_x * (n_z / 2 + 1) * howmany);
+    new (&rhat) Map<ComplexVector>((std::complex<real_t> *) transformed, local_n1 * n_x * (n_z / 2 + 1) * howmany);
 }
 
 // TODO: possibly circumvent the padding problem by accessing r as a matrix?
-template <int howmany>
-template <int padding, typename F>
-void Solver<howmany>::compute_residual_basic(RealArray &r_matrix, RealArray &u_matrix, F f)
+// f(ue, res_e, mat_index, element_idx) has to write the element residual into res_e. If f is reentrant, the
+// element loop is distributed over the OpenMP threads (see iterateCubesColored). The halo exchanges with the
+// neighbouring processes are overlapped with the element loop, see assembleWithHalo.
+template <int howmany, typename real_t>
+template <int padding, bool reentrant, typename F>
+void Solver<howmany, real_t>::compute_residual_basic(RealArray &r_matrix, RealArray &u_matrix, F f)
 {
 
-    double *r = r_matrix.data();
-    double *u = u_matrix.data();
+    real_t *r = r_matrix.data();
+    real_t *u = u_matrix.data();
     r_matrix.setZero();
     // TODO: define another eigen Map for setting this part to zero?
     for (ptrdiff_t i = local_n0 * n_y * (n_z + padding) * howmany; i < (local_n0 + 1) * n_y * (n_z + padding) * howmany; i++) {
         r[i] = 0;
     }
 
-    // int MPI_Sendrecv(void *sendbuf, int sendcount, MPI_Datatype sendtype, int dest, int sendtag, void *recvbuf,
-    //           int recvcount, MPI_Datatype recvtype, int source, int recvtag, MPI_Comm comm, MPI_Status *status)
-    MPI_Sendrecv(u, n_y * n_z * howmany, MPI_DOUBLE, (world_rank + world_size - 1) % world_size, 0,
-                 u + local_n0 * n_y * n_z * howmany, n_y * n_z * howmany, MPI_DOUBLE, (world_rank + 1) % world_size, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-    Matrix<double, howmany * 8, 1> ue;
-
-    iterateCubes<padding>([&](ptrdiff_t *idx, ptrdiff_t *idxPadding) {
+    auto assemble = [&](ptrdiff_t *idx, ptrdiff_t *idxPadding) {
+        Matrix<double, howmany * 8, 1> ue, res_e; // thread-local
         for (int i = 0; i < 8; i++) {
             for (int j = 0; j < howmany; j++) {
-                ue(howmany * i + j, 0) = u[howmany * idx[i] + j] - u[howmany * idx[0] + j];
+                ue(howmany * i + j, 0) = (double) u[howmany * idx[i] + j] - (double) u[howmany * idx[0] + j];
             }
         }
-        Matrix<double, howmany * 8, 1> &res_e = f(ue, ms[idx[0]], idx[0]);
+        f(ue, res_e, ms[idx[0]], idx[0]);
 
         for (int i = 0; i < 8; i++) {
             for (int j = 0; j < howmany; j++) {
                 r[howmany * idxPadding[i] + j] += res_e(howmany * i + j, 0);
             }
         }
-    });
-
-    MPI_Sendrecv(r + local_n0 * n_y * (n_z + padding) * howmany, n_y * (n_z + padding) * howmany, MPI_DOUBLE, (world_rank + 1) % world_size, 0,
-                 buffer_padding, n_y * (n_z + padding) * howmany, MPI_DOUBLE, (world_rank + world_size - 1) % world_size, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    };
+    assembleWithHalo<padding>(u, n_y * n_z * howmany, r, n_y * (n_z + padding) * howmany, buffer_padding, assemble, reentrant);
 
     RealArray b(buffer_padding, n_z * howmany, n_y, OuterStride<>((n_z + padding) * howmany)); // NOTE: for any padding of more than 2, the buffer_padding has to be extended
 
     r_matrix.block(0, 0, n_z * howmany, n_y) += b; // matrix.block(i,j,p,q); is the block of size (p,q), starting at (i,j)
 }
 
-template <int howmany>
+// For solvers ending on a residual evaluation the average stress is summed up as a by-product of the element loop, see
+// solve()
+template <int howmany, typename real_t>
 template <int padding>
-void Solver<howmany>::compute_residual(RealArray &r_matrix, RealArray &u_matrix)
+void Solver<howmany, real_t>::compute_residual(RealArray &r_matrix, RealArray &u_matrix)
 {
-    compute_residual_basic<padding>(r_matrix, u_matrix, [&](Matrix<double, howmany * 8, 1> &ue, int mat_index, ptrdiff_t element_idx) -> Matrix<double, howmany * 8, 1> & {
-        return matmodel->element_residual(ue, mat_index, element_idx);
+    const bool sum_stress = residualAtSolution();
+    if (sum_stress) {
+        resetStressSums();
+    }
+    // the workspace lives on the stack of every call, i.e. the material models are evaluated by all threads at once
+    compute_residual_basic<padding, true>(r_matrix, u_matrix, [&](Matrix<double, howmany * 8, 1> &ue, Matrix<double, howmany * 8, 1> &res_e, int mat_index, ptrdiff_t element_idx) {
+        typename Matmodel<howmany>::Workspace ws;
+        matmodel->element_residual(ue, mat_index, element_idx, res_e, ws);
+        if (sum_stress) {
+            addStressSums<Matmodel<howmany>::n_str>(ws.sigma);
+        }
     });
+    if (sum_stress) {
+        stress_sums_gradient = matmodel->macroscale_loading;
+    }
 }
 
-template <int howmany>
-void Solver<howmany>::solve()
+template <int howmany, typename real_t>
+void Solver<howmany, real_t>::solve()
 {
 
-    err_all          = ArrayXd::Zero(n_it + 1);
-    fft_time         = 0.0;
-    clock_t tot_time = clock();
+    updateInternalVariables();
+    err_all         = ArrayXd::Zero(n_it + 1);
+    fft_time        = 0.0;
+    double tot_time = MPI_Wtime();
+    if (reader.reference_medium == "adaptive") {
+        updateReferenceMedium();
+    }
     internalSolve();
-    tot_time = clock() - tot_time;
+    // the stress summed up by the last residual evaluation is the homogenized stress of the solution
+    homogenized_stress_current = residualAtSolution() && !stress_sums_gradient.empty() && stress_sums_gradient == matmodel->macroscale_loading;
+    if (homogenized_stress_current) {
+        homogenized_stress = averageStressSums();
+    }
+    tot_time = MPI_Wtime() - tot_time;
+    Timer::add("solve", tot_time);
     // if( VERBOSITY > 5 ){
     if (world_rank == 0) {
-        printf("# FFT Time per iteration .......   %2.6f sec\n", double(fft_time) / CLOCKS_PER_SEC / iter);
-        printf("# Total FFT Time ...............   %2.6f sec\n", double(fft_time) / CLOCKS_PER_SEC);
-        printf("# Total Time per iteration .....   %2.6f sec\n", double(tot_time) / CLOCKS_PER_SEC / iter);
-        printf("# Total Time ...................   %2.6f sec\n", double(tot_time) / CLOCKS_PER_SEC);
-        printf("# FFT contribution to total time   %2.6f %% \n", 100. * double(fft_time) / double(tot_time));
+        printf("# FFT Time per iteration .......   %2.6f sec\n", fft_time / iter);
+        printf("# Total FFT Time ...............   %2.6f sec\n", fft_time);
+        printf("# Total Time per iteration .....   %2.6f sec\n", tot_time / iter);
+        printf("# Total Time ...................   %2.6f sec\n", tot_time);
+        printf("# FFT contribution to total time   %2.6f %% \n", 100. * fft_time / tot_time);
     }
+    history_pending = true;
+}
+
+// The converged state of a time step becomes the history only here, so the stress, the tangent and the internal
+// variables written by postprocess are all evaluated with the history of the time step like the solution itself.
+template <int howmany, typename real_t>
+void Solver<howmany, real_t>::updateInternalVariables()
+{
+    if (!history_pending) {
+        return;
+    }
+    TimedRegion timed("constitutive_update");
     matmodel->updateInternalVariables();
+    stress_sums_gradient.clear();
+    history_pending = false;
+}
+
+// The reference follows the plastic models: the mean over the phases of the phase averaged tangent at the predictor of
+// the time step (the converged fluctuation of the last step with the new macroscale gradient), scaled to the midpoint
+// of the bounds of the phase averages. The Green operator is only rebuilt if the reference changes by more than 10%.
+template <int howmany, typename real_t>
+void Solver<howmany, real_t>::updateReferenceMedium()
+{
+    if (!matmodel->has_tangent()) {
+        return;
+    }
+    TimedRegion timed("reference_medium");
+
+    const int n_str     = Matmodel<howmany>::n_str;
+    const int n_mat     = matmodel->n_mat;
+    MatrixXd  phase_sum = MatrixXd::Zero(n_str * n_str + 1, n_mat); // summed tangents and number of Gauss points
+
+    MPI_Sendrecv(v_u, n_y * n_z * howmany, FFTWTraits<real_t>::mpi_type(), (world_rank + world_size - 1) % world_size, 0,
+                 v_u + local_n0 * n_y * n_z * howmany, n_y * n_z * howmany, FFTWTraits<real_t>::mpi_type(), (world_rank + 1) % world_size, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+    Matrix<double, howmany * 8, 1>   ue;
+    Matrix<double, n_str * 8, 1>     eps;
+    Matrix<double, n_str, n_str * 8> tangent;
+    iterateCubes<0>([&](ptrdiff_t *idx, ptrdiff_t *idxPadding) {
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < howmany; ++j) {
+                ue(howmany * i + j, 0) = v_u[howmany * idx[i] + j];
+            }
+        }
+        const int mat_index = ms[idx[0]];
+        matmodel->element_gradient(ue, eps);
+        matmodel->get_tangent(eps.data(), tangent.data(), 8, mat_index, 8 * idx[0]);
+        for (int p = 0; p < 8; ++p) {
+            Map<Matrix<double, n_str, n_str>>(phase_sum.col(mat_index).data()) += tangent.template block<n_str, n_str>(0, n_str * p);
+        }
+        phase_sum(n_str * n_str, mat_index) += 8;
+    });
+    double time = MPI_Wtime();
+    MPI_Allreduce(MPI_IN_PLACE, phase_sum.data(), phase_sum.size(), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    Timer::add("allreduce", MPI_Wtime() - time);
+
+    typename Matmodel<howmany>::StiffnessList C;
+    Matrix<double, n_str, n_str>              C0 = Matrix<double, n_str, n_str>::Zero();
+    for (int i = 0; i < n_mat; ++i) {
+        if (phase_sum(n_str * n_str, i) > 0) {
+            C.push_back(Map<Matrix<double, n_str, n_str>>(phase_sum.col(i).data()) / phase_sum(n_str * n_str, i));
+            C0 += C.back();
+        }
+    }
+    C0 /= (double) C.size();
+
+    const Matrix<double, n_str, n_str> reference = matmodel->kapparef_mat;
+    matmodel->kapparef_mat                       = C0;
+    const Vector2d bounds                        = matmodel->relative_stiffness_bounds(C);
+    C0 *= 0.5 * (bounds(0) + bounds(1));
+
+    const double change = (C0 - reference).norm() / reference.norm();
+    if (change <= 0.1) {
+        matmodel->kapparef_mat = reference;
+        return;
+    }
+    if (world_rank == 0) {
+        printf("# Reference medium changed by %.1f%%, rebuilding the Green operator\n", 100 * change);
+    }
+    matmodel->kapparef_mat = C0;
+    buildGreenOperator();
+    if (this->mixed_active) {
+        this->mbc_local.finalize(matmodel->kapparef_mat);
+    }
+    referenceMediumChanged();
+}
+
+template <int howmany, typename real_t>
+template <int padding, typename F>
+void Solver<howmany, real_t>::iterateCubes(F f)
+{
+    iterateCubes<padding>(f, 0, local_n0);
+}
+
+template <int howmany, typename real_t>
+template <int padding, typename F>
+void Solver<howmany, real_t>::iterateCubes(F f, ptrdiff_t x_begin, ptrdiff_t x_end)
+{
+    for (ptrdiff_t i_x = x_begin; i_x < x_end; ++i_x) {
+        for (ptrdiff_t i_y = 0; i_y < n_y; ++i_y) {
+            iterateLine<padding>(i_x, i_y, f);
+        }
+    }
+}
+
+/**
+ * @brief Element loop over the local slab in colored order, distributed over the OpenMP threads if parallel.
+ *
+ * The z-lines of elements are split into colors by the parity of (i_x, i_y). For an odd n_y the last line wraps
+ * around to y = 0 and gets a third y-color of its own. Lines of the same color do not share any node, so the scatter
+ * of the element residuals is free of races without atomics. The lines are visited color by color also on a single
+ * thread, i.e. the accumulation order of every node only depends on the coloring and the result is bitwise identical
+ * for any number of threads.
+ */
+template <int howmany, typename real_t>
+template <int padding, typename F>
+void Solver<howmany, real_t>::iterateCubesColored(F f, bool parallel)
+{
+    iterateCubesColored<padding>(f, 0, local_n0, parallel);
+}
+
+template <int howmany, typename real_t>
+template <int padding, typename F>
+void Solver<howmany, real_t>::iterateCubesColored(F f, ptrdiff_t x_begin, ptrdiff_t x_end, bool parallel)
+{
+    const int n_colors_y = 2 + n_y % 2;
+#pragma omp parallel if (parallel)
+    for (int color = 0; color < 2 * n_colors_y; ++color) {
+        const ptrdiff_t c_x       = color / n_colors_y;
+        const ptrdiff_t x_first   = x_begin + (x_begin % 2 != c_x); // first plane of the color in the range
+        const ptrdiff_t c_y       = color % n_colors_y;
+        const ptrdiff_t y_first   = (c_y == 2) ? n_y - 1 : c_y;
+        const ptrdiff_t n_lines_x = std::max<ptrdiff_t>(x_end - x_first + 1, 0) / 2;
+        const ptrdiff_t n_lines_y = (c_y == 2) ? 1 : (n_y - n_y % 2) / 2;
+#pragma omp for schedule(static)
+        for (ptrdiff_t k = 0; k < n_lines_x * n_lines_y; ++k) {
+            iterateLine<padding>(x_first + 2 * (k / n_lines_y), y_first + 2 * (k % n_lines_y), f);
+        }
+    }
 }
 
-template <int howmany>
+// x-planes [x_begin, x_end) of a part of the slab, local_n0 >= 4 is checked by the Reader
+template <int howmany, typename real_t>
+void Solver<howmany, real_t>::slabPartPlanes(int part, ptrdiff_t &x_begin, ptrdiff_t &x_end) const
+{
+    x_begin = (part == interior_planes) ? 1 : (part == last_plane) ? local_n0 - 1 : 0;
+    x_end   = (part == interior_planes) ? local_n0 - 1 : x_begin + 1;
+}
+
+template <int howmany, typename real_t>
 template <int padding, typename F>
-void Solver<howmany>::iterateCubes(F f)
+void Solver<howmany, real_t>::iterateSlabPart(int part, F f, bool parallel)
+{
+    ptrdiff_t x_begin, x_end;
+    slabPartPlanes(part, x_begin, x_end);
+    if (phase_sorted) {
+        iterateCubesByPhase<padding>(f, parallel, part);
+    } else {
+        iterateCubesColored<padding>(f, x_begin, x_end, parallel);
+    }
+}
+
+/**
+ * @brief Element loop of an assembly, overlapped with the exchange of the ghost planes.
+ *
+ * The ghost plane of the input in (in_plane values per x-plane, at in + local_n0 * in_plane) is received from the
+ * next process while the interior planes are assembled. The ghost plane of the output out is sent to the next
+ * process while the first plane is assembled, the plane received from the previous process is left in buffer and
+ * has to be added to the first plane of out by the caller. in may be nullptr if the element loop does not read it.
+ * Progress of the non-blocking messages depends on the MPI library, large planes may only be transferred in
+ * MPI_Waitall without an asynchronous progress thread.
+ */
+template <int howmany, typename real_t>
+template <int padding, typename F>
+void Solver<howmany, real_t>::assembleWithHalo(real_t *in, ptrdiff_t in_plane, real_t *out, ptrdiff_t out_plane, real_t *buffer, F f, bool parallel)
+{
+    const MPI_Datatype mpi_real = FFTWTraits<real_t>::mpi_type();
+    const int          prev     = (world_rank + world_size - 1) % world_size;
+    const int          next     = (world_rank + 1) % world_size;
+    MPI_Request        requests[2];
+
+    double time = MPI_Wtime();
+    if (in != nullptr) {
+        MPI_Irecv(in + local_n0 * in_plane, in_plane, mpi_real, next, 0, MPI_COMM_WORLD, &requests[0]);
+        MPI_Isend(in, in_plane, mpi_real, prev, 0, MPI_COMM_WORLD, &requests[1]);
+    }
+    Timer::add("halo_exchange", MPI_Wtime() - time);
+
+    time = MPI_Wtime();
+    iterateSlabPart<padding>(interior_planes, f, parallel);
+    Timer::add("residual_assembly", MPI_Wtime() - time);
+
+    time = MPI_Wtime();
+    if (in != nullptr) {
+        MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+    }
+    Timer::add("halo_exchange", MPI_Wtime() - time);
+
+    time = MPI_Wtime();
+    iterateSlabPart<padding>(last_plane, f, parallel);
+    Timer::add("residual_assembly", MPI_Wtime() - time);
+
+    time = MPI_Wtime();
+    MPI_Irecv(buffer, out_plane, mpi_real, prev, 1, MPI_COMM_WORLD, &requests[0]);
+    MPI_Isend(out + local_n0 * out_plane, out_plane, mpi_real, next, 1, MPI_COMM_WORLD, &requests[1]);
+    Timer::add("halo_exchange", MPI_Wtime() - time);
+
+    time = MPI_Wtime();
+    iterateSlabPart<padding>(first_plane, f, parallel);
+    Timer::add("residual_assembly", MPI_Wtime() - time);
+
+    time = MPI_Wtime();
+    MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+    Timer::add("halo_exchange", MPI_Wtime() - time);
+}
+
+/**
+ * @brief Sorts the local elements into one list per part of the slab, color and phase (counting sort over ms).
+ *
+ * The colors are the parities of (i_x, i_y, i_z), so two elements of the same color never share a node and any
+ * subset of a color can be assembled concurrently. Within a color the elements are sorted by phase, i.e. consecutive
+ * elements use the same material parameters. Every node receives at most one contribution per color, so the result
+ * does not depend on the number of threads. Periodicity in y and z requires even n_y and n_z for the coloring,
+ * otherwise a single color is used and the element loop runs serially. The lists of (part, color, phase) start at
+ * phase_element_offsets[(part * n_phase_colors + color) * n_phases + phase], the parts are the ones of slabPartPlanes.
+ */
+template <int howmany, typename real_t>
+void Solver<howmany, real_t>::buildPhaseElementLists()
 {
+    const ptrdiff_t n_elements = local_n0 * n_y * n_z;
+    n_phase_colors             = (n_y % 2 == 0 && n_z % 2 == 0) ? 8 : 1;
+    n_phases                   = n_elements > 0 ? *std::max_element(ms, ms + n_elements) + 1 : 0;
+    if (n_phase_colors == 1 && world_rank == 0) {
+        printf("# WARNING: phase_sorted_elements needs even n_y and n_z for a parallel element loop\n");
+    }
 
-    auto Idx = [&](int i_x, int i_y) {
+    auto list_of = [&](ptrdiff_t element) {
+        const ptrdiff_t i_z   = element % n_z;
+        const ptrdiff_t i_y   = (element / n_z) % n_y;
+        const ptrdiff_t i_x   = element / (n_z * n_y);
+        const int       color = n_phase_colors == 8 ? 4 * (i_x % 2) + 2 * (i_y % 2) + (i_z % 2) : 0;
+        const int       part  = (i_x == local_n0 - 1) ? last_plane : (i_x == 0) ? first_plane : interior_planes;
+        return (part * n_phase_colors + color) * n_phases + ms[element];
+    };
+
+    phase_element_offsets.assign(n_slab_parts * n_phase_colors * n_phases + 1, 0);
+    for (ptrdiff_t element = 0; element < n_elements; ++element) {
+        phase_element_offsets[list_of(element) + 1]++;
+    }
+    for (size_t list = 1; list < phase_element_offsets.size(); ++list) {
+        phase_element_offsets[list] += phase_element_offsets[list - 1];
+    }
+    vector<ptrdiff_t> next(phase_element_offsets.begin(), phase_element_offsets.end() - 1);
+    phase_elements.resize(n_elements);
+    for (ptrdiff_t element = 0; element < n_elements; ++element) {
+        phase_elements[next[list_of(element)]++] = element;
+    }
+}
+
+// Same element loop as iterateCubes, but phase by phase over the lists of buildPhaseElementLists. With parallel,
+// the elements of a color are distributed over the OpenMP threads (f has to be reentrant) in blocks of n_z entries of
+// phase_elements, which are the work units of resetStressSums.
+template <int howmany, typename real_t>
+template <int padding, typename F>
+void Solver<howmany, real_t>::iterateCubesByPhase(F f, bool parallel)
+{
+    for (int part = 0; part < n_slab_parts; ++part) {
+        iterateCubesByPhase<padding>(f, parallel, part);
+    }
+}
+
+template <int howmany, typename real_t>
+template <int padding, typename F>
+void Solver<howmany, real_t>::iterateCubesByPhase(F f, bool parallel, int part)
+{
+#pragma omp parallel if (parallel && n_phase_colors > 1)
+    {
+        ptrdiff_t idx[8], idxPadding[8];
+        for (int color = part * n_phase_colors; color < (part + 1) * n_phase_colors; ++color) {
+            const ptrdiff_t begin = phase_element_offsets[color * n_phases];
+            const ptrdiff_t end   = phase_element_offsets[(color + 1) * n_phases];
+#pragma omp for schedule(static)
+            for (ptrdiff_t block = begin / n_z; block < (end + n_z - 1) / n_z; ++block) {
+                work_unit[8 * threadIndex()] = block;
+                for (ptrdiff_t k = std::max(begin, block * n_z); k < std::min(end, (block + 1) * n_z); ++k) {
+                    elementNodes<padding>(phase_elements[k], idx, idxPadding);
+                    f(idx, idxPadding);
+                }
+            }
+        }
+    }
+}
+
+// Node indices of a single element in the same order as iterateLine: bit 0 of the node is x, bit 1 is y, bit 2 is z
+template <int howmany, typename real_t>
+template <int padding>
+void Solver<howmany, real_t>::elementNodes(ptrdiff_t element, ptrdiff_t *idx, ptrdiff_t *idxPadding) const
+{
+    const ptrdiff_t i_z  = element % n_z;
+    const ptrdiff_t i_y  = (element / n_z) % n_y;
+    const ptrdiff_t i_x  = element / (n_z * n_y);
+    const ptrdiff_t x[2] = {i_x, i_x + 1};
+    const ptrdiff_t y[2] = {i_y, i_y + 1 < n_y ? i_y + 1 : 0};
+    const ptrdiff_t z[2] = {i_z, i_z + 1 < n_z ? i_z + 1 : 0};
+    for (int i = 0; i < 8; ++i) {
+        const ptrdiff_t line = n_y * x[i & 1] + y[(i >> 1) & 1];
+        idx[i]               = n_z * line + z[i >> 2];
+        idxPadding[i]        = (n_z + padding) * line + z[i >> 2];
+    }
+}
+
+template <int howmany, typename real_t>
+template <int padding, typename F>
+void Solver<howmany, real_t>::iterateLine(ptrdiff_t i_x, ptrdiff_t i_y, F &f)
+{
+    work_unit[8 * threadIndex()] = n_y * i_x + i_y; // see resetStressSums
+
+    auto Idx = [&](ptrdiff_t i_x, ptrdiff_t i_y) {
         if (i_y >= n_y)
             i_y -= n_y;
         return (n_z) * (n_y * i_x + i_y);
     };
-    auto IdxPadding = [&](int i_x, int i_y) {
+    auto IdxPadding = [&](ptrdiff_t i_x, ptrdiff_t i_y) {
         if (i_y >= n_y)
             i_y -= n_y;
         return (n_z + padding) * (n_y * i_x + i_y);
     };
     ptrdiff_t idx[8], idxPadding[8];
 
-    for (int i_x = 0; i_x < local_n0; ++i_x) {
-        for (int i_y = 0; i_y < n_y; ++i_y) {
-
-            idx[0] = Idx(i_x, i_y);
-            idx[1] = Idx(i_x + 1, i_y);
-            idx[2] = Idx(i_x, i_y + 1);
-            idx[3] = Idx(i_x + 1, i_y + 1);
-            idx[4] = idx[0] + 1;
-            idx[5] = idx[1] + 1;
-            idx[6] = idx[2] + 1;
-            idx[7] = idx[3] + 1;
-
-            idxPadding[0] = IdxPadding(i_x, i_y);
-            idxPadding[1] = IdxPadding(i_x + 1, i_y);
-            idxPadding[2] = IdxPadding(i_x, i_y + 1);
-            idxPadding[3] = IdxPadding(i_x + 1, i_y + 1);
-            idxPadding[4] = idxPadding[0] + 1;
-            idxPadding[5] = idxPadding[1] + 1;
-            idxPadding[6] = idxPadding[2] + 1;
-            idxPadding[7] = idxPadding[3] + 1;
-
-            for (int i_z = 0; i_z < n_z - 1; ++i_z) {
-                f(idx, idxPadding);
-                idx[0]++;
-                idx[1]++;
-                idx[2]++;
-                idx[3]++;
-                idx[4]++;
-                idx[5]++;
-                idx[6]++;
-                idx[7]++;
-
-                idxPadding[0]++;
-                idxPadding[1]++;
-                idxPadding[2]++;
-                idxPadding[3]++;
-                idxPadding[4]++;
-                idxPadding[5]++;
-                idxPadding[6]++;
-                idxPadding[7]++;
-            }
+    idx[0] = Idx(i_x, i_y);
+    idx[1] = Idx(i_x + 1, i_y);
+    idx[2] = Idx(i_x, i_y + 1);
+    idx[3] = Idx(i_x + 1, i_y + 1);
+    idx[4] = idx[0] + 1;
+    idx[5] = idx[1] + 1;
+    idx[6] = idx[2] + 1;
+    idx[7] = idx[3] + 1;
+
+    idxPadding[0] = IdxPadding(i_x, i_y);
+    idxPadding[1] = IdxPadding(i_x + 1, i_y);
+    idxPadding[2] = IdxPadding(i_x, i_y + 1);
+    idxPadding[3] = IdxPadding(i_x + 1, i_y + 1);
+    idxPadding[4] = idxPadding[0] + 1;
+    idxPadding[5] = idxPadding[1] + 1;
+    idxPadding[6] = idxPadding[2] + 1;
+    idxPadding[7] = idxPadding[3] + 1;
+
+    for (int i_z = 0; i_z < n_z - 1; ++i_z) {
+        f(idx, idxPadding);
+        idx[0]++;
+        idx[1]++;
+        idx[2]++;
+        idx[3]++;
+        idx[4]++;
+        idx[5]++;
+        idx[6]++;
+        idx[7]++;
+
+        idxPadding[0]++;
+        idxPadding[1]++;
+        idxPadding[2]++;
+        idxPadding[3]++;
+        idxPadding[4]++;
+        idxPadding[5]++;
+        idxPadding[6]++;
+        idxPadding[7]++;
+    }
+
+    idx[4] -= n_z;
+    idx[5] -= n_z;
+    idx[6] -= n_z;
+    idx[7] -= n_z;
 
-            idx[4] -= n_z;
-            idx[5] -= n_z;
-            idx[6] -= n_z;
-            idx[7] -= n_z;
+    idxPadding[4] -= n_z;
+    idxPadding[5] -= n_z;
+    idxPadding[6] -= n_z;
+    idxPadding[7] -= n_z;
 
-            idxPadding[4] -= n_z;
-            idxPadding[5] -= n_z;
-            idxPadding[6] -= n_z;
-            idxPadding[7] -= n_z;
+    f(idx, idxPadding);
+}
 
-            f(idx, idxPadding);
+// Applies the real symmetric block G of the Green operator to one mode of the transformed residual. Only the UpLo
+// triangle of the column-major block is read, so the packed storage of fundamentalSolution is used in place. Real and
+// imaginary parts of the mode are stored interleaved and updated as pairs, without a complex copy of G.
+template <int howmany, int UpLo, typename real_G, typename real_t>
+inline void applyGreenBlock(const real_G *G, std::complex<real_t> *x)
+{
+    real_t *X              = reinterpret_cast<real_t *>(x);
+    real_t  Y[2 * howmany] = {};
+    for (int j = 0; j < howmany; ++j) {
+        for (int i = 0; i < howmany; ++i) {
+            const real_t g = ((UpLo == Lower) == (i >= j)) ? (real_t) G[j * howmany + i] : (real_t) G[i * howmany + j];
+            Y[2 * i] += g * X[2 * j];
+            Y[2 * i + 1] += g * X[2 * j + 1];
         }
     }
+    std::copy(Y, Y + 2 * howmany, X);
 }
 
-template <int howmany>
-void Solver<howmany>::convolution()
+template <int howmany, typename real_t>
+void Solver<howmany, real_t>::convolution()
 {
 
     // it is important that at least one of the dimensions n_x and n_z is divisible by two (or local_n1, but that can't be guaranteed from the outside)
     // discussion of real times complex: https://forum.kde.org/viewtopic.php?f=74&t=85678
 
-    clock_t dtime = clock();
-    fftw_execute(planfft);
-    fft_time += clock() - dtime;
-    buftime = clock() - dtime;
-
-    Matrix<complex<double>, howmany, howmany> tmp;
-    for (ptrdiff_t i = 0; i < (local_n1 * n_x * (n_z / 2 + 1)) / 2; i++) {
-
-        tmp                                          = fundamentalSolution.template middleCols<howmany>(i * (howmany + 1)).template cast<complex<double>>();
-        rhat.segment<howmany>(2 * i * howmany)       = tmp.template selfadjointView<Lower>() * rhat.segment<howmany>(2 * i * howmany);
-        tmp                                          = fundamentalSolution.template middleCols<howmany>(i * (howmany + 1) + 1).template cast<complex<double>>();
-        rhat.segment<howmany>((2 * i + 1) * howmany) = tmp.template selfadjointView<Upper>() * rhat.segment<howmany>((2 * i + 1) * howmany);
+    double dtime = MPI_Wtime();
+    FFTWTraits<real_t>::execute(planfft);
+    buftime = MPI_Wtime() - dtime;
+    Timer::add("fft_forward", buftime);
+
+    dtime                   = MPI_Wtime();
+    std::complex<real_t> *x = rhat.data();
+    if (green_on_the_fly) {
+#pragma omp parallel for collapse(2) schedule(static)
+        for (ptrdiff_t i_y = 0; i_y < local_n1; ++i_y) {
+            for (ptrdiff_t i_x = 0; i_x < n_x; ++i_x) {
+                for (ptrdiff_t i_z = 0; i_z < n_z / 2 + 1; ++i_z) {
+                    ptrdiff_t ind = i_y * n_x * (n_z / 2 + 1) + i_x * (n_z / 2 + 1) + i_z;
+                    if (i_x != 0 || (local_1_start + i_y) != 0 || i_z != 0) {
+                        const Matrix<double, howmany, howmany> G = greenBlock(i_x, i_y, i_z);
+                        applyGreenBlock<howmany, Lower>(G.data(), x + ind * howmany);
+                    } else {
+                        rhat.template segment<howmany>(ind * howmany).setZero();
+                    }
+                }
+            }
+        }
+    } else {
+        // two modes share howmany + 1 columns of the packed storage: the even one in the lower, the odd one in the upper triangle
+        const real_t *G = fundamentalSolution.data();
+#pragma omp parallel for schedule(static)
+        for (ptrdiff_t i = 0; i < (local_n1 * n_x * (n_z / 2 + 1)) / 2; i++) {
+            applyGreenBlock<howmany, Lower>(G + i * (howmany + 1) * howmany, x + 2 * i * howmany);
+            applyGreenBlock<howmany, Upper>(G + (i * (howmany + 1) + 1) * howmany, x + (2 * i + 1) * howmany);
+        }
     }
 
-    dtime = clock();
-    fftw_execute(planifft);
-    fft_time += clock() - dtime;
-    buftime += clock() - dtime;
+    Timer::add("convolution", MPI_Wtime() - dtime);
+
+    dtime = MPI_Wtime();
+    FFTWTraits<real_t>::execute(planifft);
+    dtime = MPI_Wtime() - dtime;
+    Timer::add("fft_inverse", dtime);
+    buftime += dtime;
+    fft_time += buftime;
 }
 
-template <int howmany>
-double Solver<howmany>::compute_error(RealArray &r)
+template <int howmany, typename real_t>
+double Solver<howmany, real_t>::local_residual_norm(RealArray &r)
 {
     double             err_local;
     const std::string &measure = reader.errorParameters["measure"].get<std::string>();
     if (measure == "L1") {
-        err_local = r.matrix().lpNorm<1>();
+        err_local = accumulate_double ? r.matrix().template cast<double>().template lpNorm<1>() : r.matrix().template lpNorm<1>();
     } else if (measure == "L2") {
-        err_local = r.matrix().lpNorm<2>();
+        err_local = accumulate_double ? r.matrix().template cast<double>().template lpNorm<2>() : r.matrix().template lpNorm<2>();
     } else if (measure == "Linfinity") {
-        err_local = r.matrix().lpNorm<Infinity>();
+        err_local = r.matrix().template lpNorm<Infinity>();
     } else {
         throw std::runtime_error("Unknown measure type: " + measure);
     }
+    return err_local;
+}
 
+template <int howmany, typename real_t>
+double Solver<howmany, real_t>::residual_norm(RealArray &r)
+{
+    double err_local = local_residual_norm(r);
     double err;
+    double time = MPI_Wtime();
     MPI_Allreduce(&err_local, &err, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    Timer::add("allreduce", MPI_Wtime() - time);
+    return err;
+}
+
+template <int howmany, typename real_t>
+double Solver<howmany, real_t>::compute_error(RealArray &r)
+{
+    return compute_error(residual_norm(r));
+}
 
+template <int howmany, typename real_t>
+double Solver<howmany, real_t>::compute_error(double err)
+{
     err_all[iter]  = err;
     double err0    = err_all[0];
     double err_rel = (iter == 0 ? 100 : err / err0);
@@ -401,7 +1017,7 @@ double Solver<howmany>::compute_error(RealArray &r)
         if (iter == 0) {
             printf("Before 1st iteration: %16.8e\n", err0);
         } else {
-            printf("it %3lu .... err %16.8e  / %8.4e, ratio: %4.8e, FFT time: %2.6f sec\n", iter, err, err / err0, (iter == 1 ? 0.0 : err / err_all[iter - 1]), double(buftime) / CLOCKS_PER_SEC);
+            printf("it %3lu .... err %16.8e  / %8.4e, ratio: %4.8e, FFT time: %2.6f sec\n", iter, err, err / err0, (iter == 1 ? 0.0 : err / err_all[iter - 1]), buftime);
         }
     }
 
@@ -415,14 +1031,50 @@ double Solver<howmany>::compute_error(RealArray &r)
     }
 }
 
-template <int howmany>
-void Solver<howmany>::postprocess(Reader reader, const char resultsFileName[], int load_idx, int time_idx)
+// Intermediate products of Solver::postprocess. Every result depends on a set of products (postprocessProducts), a
+// product may depend on other products, only the products needed for the requested results are evaluated.
+enum PostprocessProduct : unsigned {
+    ElementStrain = 1 << 0, //!< Element averaged strain field
+    ElementStress = 1 << 1, //!< Element averaged stress field
+    PhaseAverages = 1 << 2, //!< Strain and stress averaged per phase
+    StressAverage = 1 << 3, //!< Homogenized stress
+    StrainAverage = 1 << 4, //!< Homogenized strain, the macroscale gradient as the fluctuation is periodic
+    Displacement  = 1 << 5, //!< Total displacement g0 X + v_u
+};
+
+inline unsigned postprocessProducts(const vector<string> &results)
+{
+    static const std::map<string, unsigned> result_products = {
+        {"stress_average", StressAverage}, {"strain_average", StrainAverage}, {"phase_stress_average", PhaseAverages},
+        {"phase_strain_average", PhaseAverages}, {"displacement", Displacement}, {"strain", ElementStrain}, {"stress", ElementStress}};
+    static const std::map<unsigned, unsigned> product_dependencies = {{Displacement, StrainAverage}};
+
+    unsigned products = StressAverage | StrainAverage; // printed after every time step
+    for (const string &result : results) {
+        auto it = result_products.find(result);
+        if (it != result_products.end()) {
+            products |= it->second;
+        }
+    }
+    for (const auto &dependency : product_dependencies) {
+        if (products & dependency.first) {
+            products |= dependency.second;
+        }
+    }
+    return products;
+}
+
+// The products of the requested results share one element pass, which is skipped if only the homogenized stress is
+// needed and solve() kept it from the last residual evaluation (see residualAtSolution)
+template <int howmany, typename real_t>
+void Solver<howmany, real_t>::postprocess(Reader reader, const char resultsFileName[], int load_idx, int time_idx)
 {
-    int      n_str          = matmodel->n_str;
-    VectorXd strain         = VectorXd::Zero(local_n0 * n_y * n_z * n_str);
-    VectorXd stress         = VectorXd::Zero(local_n0 * n_y * n_z * n_str);
-    VectorXd stress_average = VectorXd::Zero(n_str);
-    VectorXd strain_average = VectorXd::Zero(n_str);
+    TimedRegion    timed("postprocess");
+    const int      n_str    = matmodel->n_str;
+    const unsigned products = postprocessProducts(reader.resultsToWrite);
+    VectorXd       strain, stress;
+    VectorXd       stress_average = VectorXd::Zero(n_str);
+    VectorXd       strain_average = Map<VectorXd>(matmodel->macroscale_loading.data(), n_str);
 
     // Initialize per-phase accumulators
     int              n_mat = reader.n_mat;
@@ -430,43 +1082,66 @@ void Solver<howmany>::postprocess(Reader reader, const char resultsFileName[], i
     vector<VectorXd> phase_strain_average(n_mat, VectorXd::Zero(n_str));
     vector<int>      phase_counts(n_mat, 0);
 
-    MPI_Sendrecv(v_u, n_y * n_z * howmany, MPI_DOUBLE, (world_rank + world_size - 1) % world_size, 0,
-                 v_u + local_n0 * n_y * n_z * howmany, n_y * n_z * howmany, MPI_DOUBLE, (world_rank + 1) % world_size, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    if (products & (ElementStrain | ElementStress | PhaseAverages)) {
+        strain.resize((products & ElementStrain) ? local_n0 * n_y * n_z * n_str : 0);
+        stress.resize((products & ElementStress) ? local_n0 * n_y * n_z * n_str : 0);
 
-    Matrix<double, howmany * 8, 1> ue;
-    int                            mat_index;
-    iterateCubes<0>([&](ptrdiff_t *idx, ptrdiff_t *idxPadding) {
-        for (int i = 0; i < 8; ++i) {
-            for (int j = 0; j < howmany; ++j) {
-                ue(howmany * i + j, 0) = v_u[howmany * idx[i] + j];
-            }
-        }
-        mat_index = ms[idx[0]];
+        MPI_Sendrecv(v_u, n_y * n_z * howmany, FFTWTraits<real_t>::mpi_type(), (world_rank + world_size - 1) % world_size, 0,
+                     v_u + local_n0 * n_y * n_z * howmany, n_y * n_z * howmany, FFTWTraits<real_t>::mpi_type(), (world_rank + 1) % world_size, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
 
-        matmodel->getStrainStress(strain.segment(n_str * idx[0], n_str).data(), stress.segment(n_str * idx[0], n_str).data(), ue, mat_index, idx[0]);
-        stress_average += stress.segment(n_str * idx[0], n_str);
-        strain_average += strain.segment(n_str * idx[0], n_str);
+        Matrix<double, howmany * 8, 1>        ue;
+        Matrix<double, Dynamic, 1>            strain_e(n_str), stress_e(n_str);
+        typename Matmodel<howmany>::Workspace ws;
+        auto                                  element_strain_stress = [&](ptrdiff_t *idx, ptrdiff_t *idxPadding) {
+            for (int i = 0; i < 8; ++i) {
+                for (int j = 0; j < howmany; ++j) {
+                    ue(howmany * i + j, 0) = v_u[howmany * idx[i] + j];
+                }
+            }
+            const int mat_index = ms[idx[0]];
 
-        phase_stress_average[mat_index] += stress.segment(n_str * idx[0], n_str);
-        phase_strain_average[mat_index] += strain.segment(n_str * idx[0], n_str);
-        phase_counts[mat_index]++;
-    });
+            matmodel->getStrainStress(strain_e.data(), stress_e.data(), ue, mat_index, idx[0], ws);
+            stress_average += stress_e;
+            if (products & ElementStrain) {
+                strain.segment(n_str * idx[0], n_str) = strain_e;
+            }
+            if (products & ElementStress) {
+                stress.segment(n_str * idx[0], n_str) = stress_e;
+            }
+            if (products & PhaseAverages) {
+                phase_stress_average[mat_index] += stress_e;
+                phase_strain_average[mat_index] += strain_e;
+                phase_counts[mat_index]++;
+            }
+        };
+        if (phase_sorted) {
+            iterateCubesByPhase<0>(element_strain_stress, false);
+        } else {
+            iterateCubes<0>(element_strain_stress);
+        }
 
-    MPI_Allreduce(MPI_IN_PLACE, stress_average.data(), n_str, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-    MPI_Allreduce(MPI_IN_PLACE, strain_average.data(), n_str, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-    stress_average /= (n_x * n_y * n_z);
-    strain_average /= (n_x * n_y * n_z);
+        double time = MPI_Wtime();
+        MPI_Allreduce(MPI_IN_PLACE, stress_average.data(), n_str, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        Timer::add("allreduce", MPI_Wtime() - time);
+        stress_average /= (n_x * n_y * n_z);
+    } else if (homogenized_stress_current) {
+        stress_average = homogenized_stress;
+    } else {
+        stress_average = get_homogenized_stress();
+    }
 
     // Reduce per-phase accumulations across all processes
-    for (int mat_index = 0; mat_index < n_mat; ++mat_index) {
-        MPI_Allreduce(MPI_IN_PLACE, phase_stress_average[mat_index].data(), n_str, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-        MPI_Allreduce(MPI_IN_PLACE, phase_strain_average[mat_index].data(), n_str, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-        MPI_Allreduce(MPI_IN_PLACE, &phase_counts[mat_index], 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
-
-        // Compute average for each phase
-        if (phase_counts[mat_index] > 0) {
-            phase_stress_average[mat_index] /= phase_counts[mat_index];
-            phase_strain_average[mat_index] /= phase_counts[mat_index];
+    if (products & PhaseAverages) {
+        for (int mat_index = 0; mat_index < n_mat; ++mat_index) {
+            MPI_Allreduce(MPI_IN_PLACE, phase_stress_average[mat_index].data(), n_str, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            MPI_Allreduce(MPI_IN_PLACE, phase_strain_average[mat_index].data(), n_str, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            MPI_Allreduce(MPI_IN_PLACE, &phase_counts[mat_index], 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+            // Compute average for each phase
+            if (phase_counts[mat_index] > 0) {
+                phase_stress_average[mat_index] /= phase_counts[mat_index];
+                phase_strain_average[mat_index] /= phase_counts[mat_index];
+            }
         }
     }
 
@@ -482,43 +1157,46 @@ void Solver<howmany>::postprocess(Reader reader, const char resultsFileName[], i
     }
 
     /* ====================================================================== *
-     *  u_total = g0·X  +  ũ          (vector or scalar, decided at compile time)
+     *  u_total = g0·X  +  ũ          (vector or scalar, decided at compile time)
      * ====================================================================== */
-    const double     dx  = reader.l_e[0];
-    const double     dy  = reader.l_e[1];
-    const double     dz  = reader.l_e[2];
-    const double     Lx2 = reader.L[0] / 2.0;
-    const double     Ly2 = reader.L[1] / 2.0;
-    const double     Lz2 = reader.L[2] / 2.0;
-    constexpr double rs2 = 0.7071067811865475; // 1.0 / std::sqrt(2.0)
-    VectorXd         u_total(local_n0 * n_y * n_z * howmany);
-    /* ---------- single sweep ------------------------------------------------- */
-    ptrdiff_t n = 0;
-    for (ptrdiff_t ix = 0; ix < local_n0; ++ix) {
-        const double x = (local_0_start + ix) * dx - Lx2;
-        for (ptrdiff_t iy = 0; iy < n_y; ++iy) {
-            const double y = iy * dy - Ly2;
-            for (ptrdiff_t iz = 0; iz < n_z; ++iz, ++n) {
-                const double z = iz * dz - Lz2;
-                if (howmany == 3) { /* ===== mechanics (vector) ===== */
-                    const double    g11 = strain_average[0];
-                    const double    g22 = strain_average[1];
-                    const double    g33 = strain_average[2];
-                    const double    g12 = strain_average[3] * rs2;
-                    const double    g13 = strain_average[4] * rs2;
-                    const double    g23 = strain_average[5] * rs2;
-                    const double    ux  = g11 * x + g12 * y + g13 * z;
-                    const double    uy  = g12 * x + g22 * y + g23 * z;
-                    const double    uz  = g13 * x + g23 * y + g33 * z;
-                    const ptrdiff_t b   = 3 * n;
-                    u_total[b]          = v_u[b] + ux;
-                    u_total[b + 1]      = v_u[b + 1] + uy;
-                    u_total[b + 2]      = v_u[b + 2] + uz;
-                } else { /* ===== scalar (howmany==1) ==== */
-                    const double g1 = strain_average[0];
-                    const double g2 = strain_average[1];
-                    const double g3 = strain_average[2];
-                    u_total[n]      = v_u[n] + (g1 * x + g2 * y + g3 * z);
+    VectorXd u_total;
+    if (products & Displacement) {
+        const double     dx  = reader.l_e[0];
+        const double     dy  = reader.l_e[1];
+        const double     dz  = reader.l_e[2];
+        const double     Lx2 = reader.L[0] / 2.0;
+        const double     Ly2 = reader.L[1] / 2.0;
+        const double     Lz2 = reader.L[2] / 2.0;
+        constexpr double rs2 = 0.7071067811865475; // 1.0 / std::sqrt(2.0)
+        u_total.resize(local_n0 * n_y * n_z * howmany);
+        /* ---------- single sweep ------------------------------------------------- */
+        ptrdiff_t n = 0;
+        for (ptrdiff_t ix = 0; ix < local_n0; ++ix) {
+            const double x = (local_0_start + ix) * dx - Lx2;
+            for (ptrdiff_t iy = 0; iy < n_y; ++iy) {
+                const double y = iy * dy - Ly2;
+                for (ptrdiff_t iz = 0; iz < n_z; ++iz, ++n) {
+                    const double z = iz * dz - Lz2;
+                    if (howmany == 3) { /* ===== mechanics (vector) ===== */
+                        const double    g11 = strain_average[0];
+                        const double    g22 = strain_average[1];
+                        const double    g33 = strain_average[2];
+                        const double    g12 = strain_average[3] * rs2;
+                        const double    g13 = strain_average[4] * rs2;
+                        const double    g23 = strain_average[5] * rs2;
+                        const double    ux  = g11 * x + g12 * y + g13 * z;
+                        const double    uy  = g12 * x + g22 * y + g23 * z;
+                        const double    uz  = g13 * x + g23 * y + g33 * z;
+                        const ptrdiff_t b   = 3 * n;
+                        u_total[b]          = v_u[b] + ux;
+                        u_total[b + 1]      = v_u[b + 1] + uy;
+                        u_total[b + 2]      = v_u[b + 2] + uz;
+                    } else { /* ===== scalar (howmany==1) ==== */
+                        const double g1 = strain_average[0];
+                        const double g2 = strain_average[1];
+                        const double g3 = strain_average[2];
+                        u_total[n]      = v_u[n] + (g1 * x + g2 * y + g3 * z);
+                    }
                 }
             }
         }
@@ -531,48 +1209,40 @@ void Solver<howmany>::postprocess(Reader reader, const char resultsFileName[], i
     // Write results to results h5 file
     auto writeData = [&](const char *resultName, const char *resultPrefix, auto *data, hsize_t *dims, int ndims) {
         if (std::find(reader.resultsToWrite.begin(), reader.resultsToWrite.end(), resultName) != reader.resultsToWrite.end()) {
-            char name[5096];
-            sprintf(name, "%s/load%i/time_step%i/%s", reader.ms_datasetname, load_idx, time_idx, resultPrefix);
-            reader.WriteData(data, resultsFileName, name, dims, ndims);
+            reader.WriteResultData(data, resultsFileName, load_idx, time_idx, resultPrefix, dims, ndims);
         }
     };
 
     auto writeSlab = [&](const char *resultName, const char *resultPrefix, auto *data, int size) {
         if (std::find(reader.resultsToWrite.begin(), reader.resultsToWrite.end(), resultName) != reader.resultsToWrite.end()) {
-            char name[5096];
-            sprintf(name, "%s/load%i/time_step%i/%s", reader.ms_datasetname, load_idx, time_idx, resultPrefix);
-            reader.WriteSlab(data, size, resultsFileName, name);
+            reader.WriteResultSlab(data, size, resultsFileName, load_idx, time_idx, resultPrefix);
         }
     };
 
-    for (int i = 0; i < world_size; ++i) {
-        if (i == world_rank) {
-            if (world_rank == 0) {
-                hsize_t dims[1] = {static_cast<hsize_t>(n_str)};
-                writeData("stress_average", "stress_average", stress_average.data(), dims, 1);
-                writeData("strain_average", "strain_average", strain_average.data(), dims, 1);
-
-                for (int mat_index = 0; mat_index < n_mat; ++mat_index) {
-                    char stress_name[512];
-                    char strain_name[512];
-                    sprintf(stress_name, "phase_stress_average_phase%d", mat_index);
-                    sprintf(strain_name, "phase_strain_average_phase%d", mat_index);
-                    writeData("phase_stress_average", stress_name, phase_stress_average[mat_index].data(), dims, 1);
-                    writeData("phase_strain_average", strain_name, phase_strain_average[mat_index].data(), dims, 1);
-                }
-                dims[0] = iter + 1;
-                writeData("absolute_error", "absolute_error", err_all.data(), dims, 1);
-            }
-            writeSlab("microstructure", "microstructure", ms, 1);
-            writeSlab("displacement_fluctuation", "displacement_fluctuation", v_u, howmany);
-            writeSlab("displacement", "displacement", u_total.data(), howmany);
-            writeSlab("residual", "residual", v_r, howmany);
-            writeSlab("strain", "strain", strain.data(), n_str);
-            writeSlab("stress", "stress", stress.data(), n_str);
-        }
-        MPI_Barrier(MPI_COMM_WORLD);
+    // The averages are identical on all processes
+    hsize_t dims[1] = {static_cast<hsize_t>(n_str)};
+    writeData("stress_average", "stress_average", stress_average.data(), dims, 1);
+    writeData("strain_average", "strain_average", strain_average.data(), dims, 1);
+
+    for (int mat_index = 0; mat_index < n_mat; ++mat_index) {
+        char stress_name[512];
+        char strain_name[512];
+        sprintf(stress_name, "phase_stress_average_phase%d", mat_index);
+        sprintf(strain_name, "phase_strain_average_phase%d", mat_index);
+        writeData("phase_stress_average", stress_name, phase_stress_average[mat_index].data(), dims, 1);
+        writeData("phase_strain_average", strain_name, phase_strain_average[mat_index].data(), dims, 1);
     }
-    matmodel->postprocess(*this, reader, resultsFileName, load_idx, time_idx);
+    dims[0] = iter + 1;
+    writeData("absolute_error", "absolute_error", err_all.data(), dims, 1);
+
+    writeSlab("microstructure", "microstructure", ms, 1);
+    writeSlab("displacement_fluctuation", "displacement_fluctuation", v_u, howmany);
+    writeSlab("displacement", "displacement", u_total.data(), howmany);
+    writeSlab("residual", "residual", v_r, howmany);
+    writeSlab("strain", "strain", strain.data(), n_str);
+    writeSlab("stress", "stress", stress.data(), n_str);
+
+    matmodel->postprocess(reader, resultsFileName, load_idx, time_idx);
 
     // Compute homogenized tangent
     if (find(reader.resultsToWrite.begin(), reader.resultsToWrite.end(), "homogenized_tangent") != reader.resultsToWrite.end()) {
@@ -582,46 +1252,94 @@ void Solver<howmany>::postprocess(Reader reader, const char resultsFileName[], i
             cout << "# Homogenized tangent: " << endl
                  << setprecision(12) << homogenized_tangent << endl
                  << endl;
-            writeData("homogenized_tangent", "homogenized_tangent", homogenized_tangent.data(), dims, 2);
         }
+        writeData("homogenized_tangent", "homogenized_tangent", homogenized_tangent.data(), dims, 2);
     }
+    reader.FlushResultsFile();
 }
 
-template <int howmany>
-VectorXd Solver<howmany>::get_homogenized_stress()
+// One column per work unit of the element loops, padded to a cache line. A unit is a z-line of elements (see
+// iterateLine) or a block of n_z entries of the phase-sorted element lists (see iterateCubesByPhase). Every unit is
+// processed by a single thread in a fixed order and the columns are summed up in the order of the units, so the sums
+// do not depend on the number of threads.
+template <int howmany, typename real_t>
+void Solver<howmany, real_t>::resetStressSums()
 {
+    stress_sums.setZero((matmodel->n_str + 7) / 8 * 8, local_n0 * n_y);
+    stress_sums_gradient.clear();
+}
 
-    int      n_str     = matmodel->n_str;
-    VectorXd strain    = VectorXd::Zero(local_n0 * n_y * n_z * n_str);
-    VectorXd stress    = VectorXd::Zero(local_n0 * n_y * n_z * n_str);
-    homogenized_stress = VectorXd::Zero(n_str);
+template <int howmany, typename real_t>
+template <int n_str>
+void Solver<howmany, real_t>::addStressSums(const Matrix<double, n_str * 8, 1> &sigma)
+{
+    double *sum = stress_sums.col(work_unit[8 * threadIndex()]).data();
+    for (int p = 0; p < 8; ++p) {
+        for (int i = 0; i < n_str; ++i) {
+            sum[i] += sigma(n_str * p + i);
+        }
+    }
+}
 
-    MPI_Sendrecv(v_u, n_y * n_z * howmany, MPI_DOUBLE, (world_rank + world_size - 1) % world_size, 0,
-                 v_u + local_n0 * n_y * n_z * howmany, n_y * n_z * howmany, MPI_DOUBLE, (world_rank + 1) % world_size, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+template <int howmany, typename real_t>
+VectorXd Solver<howmany, real_t>::averageStressSums()
+{
+    const int n_str = matmodel->n_str;
+    VectorXd  sum   = stress_sums.topRows(n_str).rowwise().sum();
 
-    Matrix<double, howmany * 8, 1> ue;
-    int                            mat_index;
-    iterateCubes<0>([&](ptrdiff_t *idx, ptrdiff_t *idxPadding) {
+    double time = MPI_Wtime();
+    MPI_Allreduce(MPI_IN_PLACE, sum.data(), n_str, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    Timer::add("allreduce", MPI_Wtime() - time);
+    return sum / (8.0 * n_x * n_y * n_z);
+}
+
+// One thread-parallel pass over the elements of v_u, the stresses are summed up without storing any field
+template <int howmany, typename real_t>
+VectorXd Solver<howmany, real_t>::get_homogenized_stress()
+{
+    MPI_Sendrecv(v_u, n_y * n_z * howmany, FFTWTraits<real_t>::mpi_type(), (world_rank + world_size - 1) % world_size, 0,
+                 v_u + local_n0 * n_y * n_z * howmany, n_y * n_z * howmany, FFTWTraits<real_t>::mpi_type(), (world_rank + 1) % world_size, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+    resetStressSums();
+    auto element_stress = [&](ptrdiff_t *idx, ptrdiff_t *idxPadding) {
+        Matrix<double, howmany * 8, 1>        ue; // thread-local
+        typename Matmodel<howmany>::Workspace ws;
         for (int i = 0; i < 8; ++i) {
             for (int j = 0; j < howmany; ++j) {
                 ue(howmany * i + j, 0) = v_u[howmany * idx[i] + j];
             }
         }
-        mat_index = ms[idx[0]];
-
-        matmodel->getStrainStress(strain.segment(n_str * idx[0], n_str).data(), stress.segment(n_str * idx[0], n_str).data(), ue, mat_index, idx[0]);
-        homogenized_stress += stress.segment(n_str * idx[0], n_str);
-    });
-
-    MPI_Allreduce(MPI_IN_PLACE, homogenized_stress.data(), n_str, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-    homogenized_stress /= (n_x * n_y * n_z);
+        matmodel->element_gradient(ue, ws.eps);
+        matmodel->get_sigma(ws.eps.data(), ws.sigma.data(), 8, ms[idx[0]], 8 * idx[0]);
+        addStressSums<Matmodel<howmany>::n_str>(ws.sigma);
+    };
+    if (phase_sorted) {
+        iterateCubesByPhase<0>(element_stress, true);
+    } else {
+        iterateCubesColored<0>(element_stress);
+    }
+    stress_sums_gradient = matmodel->macroscale_loading;
 
+    homogenized_stress = averageStressSums();
     return homogenized_stress;
 }
 
-template <int howmany>
-MatrixXd Solver<howmany>::get_homogenized_tangent(double pert_param)
+// With "tangent_solver": "batched" (default) the consistent tangent of linear models and of models with get_tangent is
+// computed by TangentSolver, all load directions at once and without changing the state of the solver. Otherwise every
+// column is a full solve, with finite differences of size pert_param for nonlinear models.
+template <int howmany, typename real_t>
+MatrixXd Solver<howmany, real_t>::get_homogenized_tangent(double pert_param)
 {
+    TimedRegion timed("homogenized_tangent");
+    if (reader.tangent_solver == "batched" && (dynamic_cast<LinearModel<howmany> *>(matmodel) != nullptr || matmodel->has_tangent())) {
+        if (tangent_solver == nullptr) {
+            tangent_solver = new TangentSolver<howmany, real_t>(*this);
+        }
+        homogenized_tangent = tangent_solver->solve();
+        homogenized_tangent = 0.5 * (homogenized_tangent + homogenized_tangent.transpose()).eval();
+        return homogenized_tangent;
+    }
+
     int n_str                         = matmodel->n_str;
     homogenized_tangent               = MatrixXd::Zero(n_str, n_str);
     VectorXd       unperturbed_stress = get_homogenized_stress();
@@ -630,10 +1348,16 @@ MatrixXd Solver<howmany>::get_homogenized_tangent(double pert_param)
     vector<double> g0       = this->matmodel->macroscale_loading;
     bool           islinear = dynamic_cast<LinearModel<howmany> *>(this->matmodel) != nullptr;
 
+    // the solver is reused afterwards, so the error settings are restored at the end
+    const json   saved_errorParameters   = this->reader.errorParameters;
+    const double saved_TOL               = this->TOL;
     this->reader.errorParameters["type"] = "relative";
     this->TOL                            = max(1e-6, this->TOL);
 
-    // TODO: a deep copy of the solver object is needed here to avoid modifying the history of the solver object
+    // The perturbed solves start from the history of the time step like the solution itself. The solution and its
+    // internal variables are restored afterwards, so the solver continues with the next time step as before.
+    const bool                            saved_history_pending = history_pending;
+    const Array<real_t, Dynamic, Dynamic> saved_u               = v_u_real;
 
     for (int i = 0; i < n_str; i++) {
         if (islinear) {
@@ -646,6 +1370,7 @@ MatrixXd Solver<howmany>::get_homogenized_tangent(double pert_param)
 
         matmodel->setGradient(pert_strain);
         disableMixedBC();
+        history_pending = false;
         solve();
         perturbed_stress = get_homogenized_stress();
 
@@ -653,6 +1378,14 @@ MatrixXd Solver<howmany>::get_homogenized_tangent(double pert_param)
     }
 
     homogenized_tangent = 0.5 * (homogenized_tangent + homogenized_tangent.transpose()).eval();
+
+    matmodel->setGradient(g0);
+    v_u_real = saved_u;
+    get_homogenized_stress();
+    history_pending = saved_history_pending;
+
+    this->reader.errorParameters = saved_errorParameters;
+    this->TOL                    = saved_TOL;
     return homogenized_tangent;
 }
 
@@ -3,22 +3,23 @@
 
 #include "solver.h"
 
-template <int howmany>
-class SolverCG : public Solver<howmany> {
+template <int howmany, typename real_t = double>
+class SolverCG : public Solver<howmany, real_t> {
   public:
-    using Solver<howmany>::n_x;
-    using Solver<howmany>::n_y;
-    using Solver<howmany>::n_z;
-    using Solver<howmany>::local_n0;
-    using Solver<howmany>::local_n1;
-    using Solver<howmany>::v_u_real;
-    using Solver<howmany>::v_r_real;
+    using Solver<howmany, real_t>::n_x;
+    using Solver<howmany, real_t>::n_y;
+    using Solver<howmany, real_t>::n_z;
+    using Solver<howmany, real_t>::local_n0;
+    using Solver<howmany, real_t>::local_n1;
+    using Solver<howmany, real_t>::v_u_real;
+    using Solver<howmany, real_t>::v_r_real;
+    using typename Solver<howmany, real_t>::RealArray;
 
     SolverCG(Reader reader, Matmodel<howmany> *matmodel);
 
-    double   *s;
-    double   *d;
-    double   *rnew;
+    real_t   *s;
+    real_t   *d;
+    real_t   *rnew;
     RealArray s_real;
     RealArray d_real;
     RealArray rnew_real;
@@ -26,38 +27,47 @@ class SolverCG : public Solver<howmany> {
     void   internalSolve();
     void   LineSearchSecant();
     double dotProduct(RealArray &a, RealArray &b);
+    double localDotProduct(RealArray &a, RealArray &b); //!< Contribution of this process to dotProduct
 
   protected:
-    using Solver<howmany>::iter;
+    using Solver<howmany, real_t>::iter;
 };
 
-template <int howmany>
-SolverCG<howmany>::SolverCG(Reader reader, Matmodel<howmany> *mat)
-    : Solver<howmany>(reader, mat),
+template <int howmany, typename real_t>
+SolverCG<howmany, real_t>::SolverCG(Reader reader, Matmodel<howmany> *mat)
+    : Solver<howmany, real_t>(reader, mat),
 
-      s(fftw_alloc_real(reader.alloc_local * 2)),
+      s(FFTWTraits<real_t>::alloc_real(reader.alloc_local * 2)),
       s_real(s, n_z * howmany, local_n0 * n_y, OuterStride<>((n_z + 2) * howmany)),
 
-      rnew(fftw_alloc_real((local_n0 + 1) * n_y * n_z * howmany)),
+      rnew(FFTWTraits<real_t>::alloc_real((local_n0 + 1) * n_y * n_z * howmany)),
       rnew_real(rnew, n_z * howmany, local_n0 * n_y, OuterStride<>(n_z * howmany)),
 
-      d(fftw_alloc_real((local_n0 + 1) * n_y * n_z * howmany)),
+      d(FFTWTraits<real_t>::alloc_real((local_n0 + 1) * n_y * n_z * howmany)),
       d_real(d, n_z * howmany, local_n0 * n_y, OuterStride<>(n_z * howmany))
 {
-    this->CreateFFTWPlans(this->v_r, (fftw_complex *) s, s);
+    this->CreateFFTWPlans(this->v_r, (typename FFTWTraits<real_t>::complex *) s, s);
 }
 
-template <int howmany>
-double SolverCG<howmany>::dotProduct(RealArray &a, RealArray &b)
+template <int howmany, typename real_t>
+double SolverCG<howmany, real_t>::localDotProduct(RealArray &a, RealArray &b)
 {
-    double local_value = (a * b).sum();
+    return this->accumulate_double ? (a.template cast<double>() * b.template cast<double>()).sum() : (a * b).sum();
+}
+
+template <int howmany, typename real_t>
+double SolverCG<howmany, real_t>::dotProduct(RealArray &a, RealArray &b)
+{
+    double local_value = localDotProduct(a, b);
     double result;
+    double time = MPI_Wtime();
     MPI_Allreduce(&local_value, &result, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    Timer::add("allreduce", MPI_Wtime() - time);
     return result;
 }
 
-template <int howmany>
-void SolverCG<howmany>::internalSolve()
+template <int howmany, typename real_t>
+void SolverCG<howmany, real_t>::internalSolve()
 {
     if (this->world_rank == 0)
         printf("\n# Start FANS - Conjugate Gradient Solver \n");
@@ -89,19 +99,17 @@ void SolverCG<howmany>::internalSolve()
         delta0 = delta;
         delta  = dotProduct(v_r_real, s_real);
 
-        d_real = s_real + fmax(0, (delta - deltamid) / delta0) * d_real;
+        d_real = s_real + (real_t) fmax(0, (delta - deltamid) / delta0) * d_real;
 
         if (islinear && !this->isMixedBCActive()) {
-            Matrix<double, howmany * 8, 1> res_e;
-            this->template compute_residual_basic<0>(rnew_real, d_real,
-                                                     [&](Matrix<double, howmany * 8, 1> &ue, int mat_index, ptrdiff_t element_idx) -> Matrix<double, howmany * 8, 1> & {
-                                                         res_e.noalias() = linearModel->phase_stiffness[mat_index] * ue;
-                                                         return res_e;
-                                                     });
+            this->template compute_residual_basic<0, true>(rnew_real, d_real,
+                                                           [&](Matrix<double, howmany * 8, 1> &ue, Matrix<double, howmany * 8, 1> &res_e, int mat_index, ptrdiff_t element_idx) {
+                                                               res_e.noalias() = linearModel->phase_stiffness[mat_index] * ue;
+                                                           });
 
             double alpha = delta / dotProduct(d_real, rnew_real);
-            v_r_real -= alpha * rnew_real;
-            v_u_real -= alpha * d_real;
+            v_r_real -= (real_t) alpha * rnew_real;
+            v_u_real -= (real_t) alpha * d_real;
         } else {
             LineSearchSecant();
         }
@@ -113,9 +121,10 @@ void SolverCG<howmany>::internalSolve()
         printf("# Complete FANS - Conjugate Gradient Solver \n");
 }
 
-template <int howmany>
-void SolverCG<howmany>::LineSearchSecant()
+template <int howmany, typename real_t>
+void SolverCG<howmany, real_t>::LineSearchSecant()
 {
+    TimedRegion timed("line_search");
     double err       = 10.0;
     int    MaxIter   = 5;
     double tol       = 1e-2;
@@ -128,7 +137,7 @@ void SolverCG<howmany>::LineSearchSecant()
 
     while (((_iter < MaxIter) && (err > tol))) {
 
-        v_u_real += d_real * (alpha_new - alpha_old);
+        v_u_real += d_real * (real_t) (alpha_new - alpha_old);
         this->updateMixedBC();
         this->template compute_residual<0>(rnew_real, v_u_real);
         r1pd = dotProduct(rnew_real, d_real);
@@ -139,7 +148,7 @@ void SolverCG<howmany>::LineSearchSecant()
         err = fabs(alpha_new - alpha_old);
         _iter++;
     }
-    v_u_real += d_real * (alpha_new - alpha_old);
+    v_u_real += d_real * (real_t) (alpha_new - alpha_old);
     v_r_real = rnew_real;
     if (this->world_rank == 0)
         printf("line search iter %i, alpha %f - error %e - ", _iter, alpha_new, err);
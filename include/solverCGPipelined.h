@@ -0,0 +1,167 @@
+#ifndef SOLVER_CG_PIPELINED_H
+#define SOLVER_CG_PIPELINED_H
+
+#include "solverCG.h"
+
+// Reduction of the scalars of an iteration of SolverCGPipelined: all entries are summed up except for the last one,
+// the residual norm of the convergence check, which is reduced with max as in Solver::residual_norm
+inline void sumMaxReduction(void *in, void *inout, int *len, MPI_Datatype *)
+{
+    const double *a = static_cast<const double *>(in);
+    double       *b = static_cast<double *>(inout);
+    for (int i = 0; i < *len - 1; ++i) {
+        b[i] += a[i];
+    }
+    b[*len - 1] = std::max(b[*len - 1], a[*len - 1]);
+}
+
+/**
+ * @brief Pipelined conjugate gradient method of Ghysels and Vanroose, method "cg_pipelined".
+ *
+ * The preconditioned CG iteration of SolverCG, rearranged such that the scalars of an iteration, gamma = (r, u),
+ * delta = (w, u) and the residual norm of the convergence check, are reduced by a single non-blocking
+ * MPI_Iallreduce. The reduction is overlapped with the convolution m = G w and the product n = K m, the other fields
+ * follow from the recurrences
+ *
+ *     z = n + beta z,   q = m + beta q,   t = w + beta t,   p = u + beta p
+ *     v_u -= alpha p,   r -= alpha t,     u -= alpha q,     w -= alpha z
+ *
+ * which keep u = G r and w = K u. In exact arithmetic the iterates are the ones of SolverCG. w lives in v_r, the
+ * input of the FFT plans, during the iteration and the residual is copied back at the end. The method stores six
+ * more fields than SolverCG and every solve needs one more convolution and product, as the convergence of an iterate
+ * is only known after the overlapped work. Only the linear path is pipelined, nonlinear models and mixed boundary
+ * conditions use the line search of SolverCG. The recurrences amplify the round-off, the method is restricted to double
+ * precision by the Reader.
+ */
+template <int howmany, typename real_t = double>
+class SolverCGPipelined : public SolverCG<howmany, real_t> {
+  public:
+    using Solver<howmany, real_t>::n_x;
+    using Solver<howmany, real_t>::n_y;
+    using Solver<howmany, real_t>::n_z;
+    using Solver<howmany, real_t>::local_n0;
+    using Solver<howmany, real_t>::v_u_real;
+    using Solver<howmany, real_t>::v_r_real;
+    using SolverCG<howmany, real_t>::s_real;
+    using SolverCG<howmany, real_t>::d_real;
+    using SolverCG<howmany, real_t>::rnew_real;
+    using typename Solver<howmany, real_t>::RealArray;
+
+    SolverCGPipelined(Reader reader, Matmodel<howmany> *matmodel);
+    ~SolverCGPipelined();
+
+    void internalSolve();
+
+  protected:
+    using Solver<howmany, real_t>::iter;
+
+    MPI_Op sum_max; //!< See sumMaxReduction
+
+    real_t   *r, *u, *m, *z, *q, *t;
+    RealArray r_real; //!< Residual
+    RealArray u_real; //!< Preconditioned residual G r
+    RealArray m_real; //!< G w, copied from the output of the FFT
+    RealArray z_real;
+    RealArray q_real;
+    RealArray t_real;
+};
+
+template <int howmany, typename real_t>
+SolverCGPipelined<howmany, real_t>::SolverCGPipelined(Reader reader, Matmodel<howmany> *mat)
+    : SolverCG<howmany, real_t>(reader, mat),
+      r(FFTWTraits<real_t>::alloc_real(local_n0 * n_y * n_z * howmany)),
+      u(FFTWTraits<real_t>::alloc_real((local_n0 + 1) * n_y * n_z * howmany)),
+      m(FFTWTraits<real_t>::alloc_real((local_n0 + 1) * n_y * n_z * howmany)),
+      z(FFTWTraits<real_t>::alloc_real(local_n0 * n_y * n_z * howmany)),
+      q(FFTWTraits<real_t>::alloc_real(local_n0 * n_y * n_z * howmany)),
+      t(FFTWTraits<real_t>::alloc_real(local_n0 * n_y * n_z * howmany)),
+      r_real(r, n_z * howmany, local_n0 * n_y, OuterStride<>(n_z * howmany)),
+      u_real(u, n_z * howmany, local_n0 * n_y, OuterStride<>(n_z * howmany)),
+      m_real(m, n_z * howmany, local_n0 * n_y, OuterStride<>(n_z * howmany)),
+      z_real(z, n_z * howmany, local_n0 * n_y, OuterStride<>(n_z * howmany)),
+      q_real(q, n_z * howmany, local_n0 * n_y, OuterStride<>(n_z * howmany)),
+      t_real(t, n_z * howmany, local_n0 * n_y, OuterStride<>(n_z * howmany))
+{
+    MPI_Op_create(&sumMaxReduction, 1, &sum_max);
+}
+
+template <int howmany, typename real_t>
+SolverCGPipelined<howmany, real_t>::~SolverCGPipelined()
+{
+    MPI_Op_free(&sum_max);
+    for (real_t *f : {r, u, m, z, q, t}) {
+        FFTWTraits<real_t>::free(f);
+    }
+}
+
+template <int howmany, typename real_t>
+void SolverCGPipelined<howmany, real_t>::internalSolve()
+{
+    LinearModel<howmany> *linearModel = dynamic_cast<LinearModel<howmany> *>(this->matmodel);
+    if (linearModel == nullptr || this->isMixedBCActive()) {
+        SolverCG<howmany, real_t>::internalSolve();
+        return;
+    }
+    if (this->world_rank == 0)
+        printf("\n# Start FANS - Pipelined Conjugate Gradient Solver \n");
+
+    auto stiffness_product = [&](Matrix<double, howmany * 8, 1> &ue, Matrix<double, howmany * 8, 1> &res_e, int mat_index, ptrdiff_t) {
+        res_e.noalias() = linearModel->phase_stiffness[mat_index] * ue;
+    };
+
+    // r, u = G r and w = K u
+    this->template compute_residual<2>(v_r_real, v_u_real);
+    r_real = v_r_real;
+    this->convolution();
+    u_real = s_real;
+    this->template compute_residual_basic<2, true>(v_r_real, u_real, stiffness_product);
+
+    z_real.setZero();
+    q_real.setZero();
+    t_real.setZero();
+    d_real.setZero();
+
+    iter             = 0;
+    double gamma_old = 1.0, alpha = 1.0;
+    while (true) {
+        double      local[3] = {this->localDotProduct(r_real, u_real), this->localDotProduct(v_r_real, u_real), this->local_residual_norm(r_real)};
+        double      global[3];
+        MPI_Request request;
+        MPI_Iallreduce(local, global, 3, MPI_DOUBLE, sum_max, MPI_COMM_WORLD, &request);
+
+        // m = G w and n = K m while the reduction is in flight
+        this->convolution();
+        m_real = s_real;
+        this->template compute_residual_basic<0, true>(rnew_real, m_real, stiffness_product);
+
+        double time = MPI_Wtime();
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        Timer::add("allreduce", MPI_Wtime() - time);
+
+        const double err_rel = this->compute_error(global[2]);
+        if (iter >= this->n_it || err_rel <= this->TOL) {
+            break;
+        }
+
+        const double gamma = global[0];
+        const double delta = global[1];
+        const double beta  = (iter == 0) ? 0.0 : gamma / gamma_old;
+        alpha              = gamma / (delta - beta * gamma / alpha);
+        gamma_old          = gamma;
+
+        z_real = rnew_real + (real_t) beta * z_real;
+        q_real = m_real + (real_t) beta * q_real;
+        t_real = v_r_real + (real_t) beta * t_real;
+        d_real = u_real + (real_t) beta * d_real;
+        v_u_real -= (real_t) alpha * d_real;
+        r_real -= (real_t) alpha * t_real;
+        u_real -= (real_t) alpha * q_real;
+        v_r_real -= (real_t) alpha * z_real;
+        iter++;
+    }
+    v_r_real = r_real;
+
+    if (this->world_rank == 0)
+        printf("# Complete FANS - Pipelined Conjugate Gradient Solver \n");
+}
+#endif
@@ -3,34 +3,38 @@
 
 #include "solver.h"
 
-template <int howmany>
-class SolverFP : public Solver<howmany> {
+template <int howmany, typename real_t = double>
+class SolverFP : public Solver<howmany, real_t> {
   public:
-    using Solver<howmany>::n_x;
-    using Solver<howmany>::n_y;
-    using Solver<howmany>::n_z;
-    using Solver<howmany>::local_n0;
-    using Solver<howmany>::local_n1;
-    using Solver<howmany>::v_u_real;
-    using Solver<howmany>::v_r_real;
+    using Solver<howmany, real_t>::n_x;
+    using Solver<howmany, real_t>::n_y;
+    using Solver<howmany, real_t>::n_z;
+    using Solver<howmany, real_t>::local_n0;
+    using Solver<howmany, real_t>::local_n1;
+    using Solver<howmany, real_t>::v_u_real;
+    using Solver<howmany, real_t>::v_r_real;
 
     SolverFP(Reader reader, Matmodel<howmany> *matmodel);
 
     void internalSolve();
+    bool residualAtSolution() const override
+    {
+        return true;
+    }
 
   protected:
-    using Solver<howmany>::iter;
+    using Solver<howmany, real_t>::iter;
 };
 
-template <int howmany>
-SolverFP<howmany>::SolverFP(Reader reader, Matmodel<howmany> *matmodel)
-    : Solver<howmany>(reader, matmodel)
+template <int howmany, typename real_t>
+SolverFP<howmany, real_t>::SolverFP(Reader reader, Matmodel<howmany> *matmodel)
+    : Solver<howmany, real_t>(reader, matmodel)
 {
-    this->CreateFFTWPlans(this->v_r, (fftw_complex *) this->v_r, this->v_r);
+    this->CreateFFTWPlans(this->v_r, (typename FFTWTraits<real_t>::complex *) this->v_r, this->v_r);
 }
 
-template <int howmany>
-void SolverFP<howmany>::internalSolve()
+template <int howmany, typename real_t>
+void SolverFP<howmany, real_t>::internalSolve()
 {
     if (this->world_rank == 0)
         printf("\n# Start FANS - Fixed Point Solver \n");
@@ -0,0 +1,144 @@
+#ifndef SOLVER_FP_ANDERSON_H
+#define SOLVER_FP_ANDERSON_H
+
+#include "solver.h"
+
+/**
+ * @brief Fixed point (basic) scheme with Anderson acceleration, method "fp_anderson".
+ *
+ * The basic scheme is the fixed point map u <- u + f(u) with the update f(u) = -G r(u). Instead of taking the plain
+ * update, the new iterate combines the last m updates such that the linearized update is minimal:
+ *
+ *     gamma   = argmin || f_k - dF gamma ||,   dF = [f_{k-m+1} - f_{k-m}, ..., f_k - f_{k-1}]
+ *     u_{k+1} = u_k + f_k - (dU + dF) gamma,  dU = [u_{k-m+1} - u_{k-m}, ..., u_k - u_{k-1}]
+ *
+ * The small least squares problem is solved with the normal equations (one allreduce per iteration). Every
+ * iteration costs one residual and one convolution as the basic scheme, plus 2m + 4 passes over the nodal fields.
+ * The macroscale gradient of mixed boundary conditions is updated after every iteration with the stress of the
+ * current iterate, i.e. it is not part of the accelerated state. For nonlinear models the history of the current
+ * time step is used.
+ */
+template <int howmany, typename real_t = double>
+class SolverFPAnderson : public Solver<howmany, real_t> {
+  public:
+    using Solver<howmany, real_t>::n_x;
+    using Solver<howmany, real_t>::n_y;
+    using Solver<howmany, real_t>::n_z;
+    using Solver<howmany, real_t>::local_n0;
+    using Solver<howmany, real_t>::local_n1;
+    using Solver<howmany, real_t>::v_u_real;
+    using Solver<howmany, real_t>::v_r_real;
+
+    typedef Array<real_t, Dynamic, Dynamic> Field;
+
+    SolverFPAnderson(Reader reader, Matmodel<howmany> *matmodel);
+
+    void internalSolve();
+    bool residualAtSolution() const override
+    {
+        return true;
+    }
+
+  protected:
+    using Solver<howmany, real_t>::iter;
+
+    const int     depth; //!< Number of stored differences m ("anderson_depth")
+    vector<Field> dU;    //!< Ring buffer of iterate differences
+    vector<Field> dF;    //!< Ring buffer of update differences
+    Field         u_prev, f_prev, f;
+
+    double localDot(const Field &a, const Field &b) const;
+};
+
+template <int howmany, typename real_t>
+SolverFPAnderson<howmany, real_t>::SolverFPAnderson(Reader reader, Matmodel<howmany> *matmodel)
+    : Solver<howmany, real_t>(reader, matmodel),
+      depth(reader.anderson_depth)
+{
+    this->CreateFFTWPlans(this->v_r, (typename FFTWTraits<real_t>::complex *) this->v_r, this->v_r);
+
+    dU.assign(depth, Field(n_z * howmany, local_n0 * n_y));
+    dF.assign(depth, Field(n_z * howmany, local_n0 * n_y));
+    u_prev.resize(n_z * howmany, local_n0 * n_y);
+    f_prev.resize(n_z * howmany, local_n0 * n_y);
+    f.resize(n_z * howmany, local_n0 * n_y);
+}
+
+template <int howmany, typename real_t>
+double SolverFPAnderson<howmany, real_t>::localDot(const Field &a, const Field &b) const
+{
+    return this->accumulate_double ? (a.template cast<double>() * b.template cast<double>()).sum() : (a * b).sum();
+}
+
+template <int howmany, typename real_t>
+void SolverFPAnderson<howmany, real_t>::internalSolve()
+{
+    if (this->world_rank == 0)
+        printf("\n# Start FANS - Anderson accelerated Fixed Point Solver (depth %i) \n", depth);
+
+    this->template compute_residual<2>(v_r_real, v_u_real);
+
+    iter           = 0;
+    double err_rel = this->compute_error(v_r_real);
+
+    MatrixXd gram = MatrixXd::Zero(depth, depth); // dF^T dF, rows and columns in ring buffer order
+    VectorXd reduced(2 * depth);
+    int      n_hist = 0; // Number of valid history entries
+    int      newest = -1;
+
+    while ((iter < this->n_it) && (err_rel > this->TOL)) {
+
+        this->convolution();
+        f = -v_r_real;
+
+        if (iter > 0) {
+            newest     = (newest + 1) % depth;
+            n_hist     = std::min(n_hist + 1, depth);
+            dU[newest] = v_u_real - u_prev;
+            dF[newest] = f - f_prev;
+        }
+        u_prev = v_u_real;
+        f_prev = f;
+
+        if (n_hist > 0) {
+            reduced.setZero();
+            // new row of the Gram matrix and the right hand side dF^T f in a single allreduce
+            for (int i = 0; i < n_hist; ++i) {
+                reduced(i)         = localDot(dF[newest], dF[i]);
+                reduced(depth + i) = localDot(dF[i], f);
+            }
+            double time = MPI_Wtime();
+            MPI_Allreduce(MPI_IN_PLACE, reduced.data(), 2 * depth, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            Timer::add("allreduce", MPI_Wtime() - time);
+            for (int i = 0; i < n_hist; ++i) {
+                gram(newest, i) = reduced(i);
+                gram(i, newest) = reduced(i);
+            }
+
+            // a nearly singular Gram matrix means that the history is linearly dependent, restart from the plain update
+            LDLT<MatrixXd> ldlt(gram.topLeftCorner(n_hist, n_hist));
+            if (ldlt.info() != Eigen::Success || ldlt.rcond() < 1e-12) {
+                n_hist = 0;
+                newest = -1;
+                v_u_real += f;
+            } else {
+                VectorXd gamma = ldlt.solve(reduced.segment(depth, n_hist));
+                v_u_real += f;
+                for (int i = 0; i < n_hist; ++i) {
+                    v_u_real -= (real_t) gamma(i) * (dU[i] + dF[i]);
+                }
+            }
+        } else {
+            v_u_real += f;
+        }
+
+        this->updateMixedBC();
+        this->template compute_residual<2>(v_r_real, v_u_real);
+
+        iter++;
+        err_rel = this->compute_error(v_r_real);
+    }
+    if (this->world_rank == 0)
+        printf("# Complete FANS - Anderson accelerated Fixed Point Solver \n");
+}
+#endif
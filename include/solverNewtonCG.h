@@ -0,0 +1,143 @@
+#ifndef SOLVER_NEWTON_CG_H
+#define SOLVER_NEWTON_CG_H
+
+#include "solverCG.h"
+
+/**
+ * @brief Inexact Newton method with the consistent tangent of the material model, method "newton_cg".
+ *
+ * Every Newton step solves the linearized problem K_t(u_k) du = -r(u_k) with the FFT-preconditioned CG method of
+ * SolverCG. The tangent is applied matrix-free: linear models use their phase_stiffness, the other models evaluate
+ * get_tangent at the Gauss points of u_k in every product (no tangent is stored). The inner CG stops at
+ *
+ *     |r_lin| <= max(eta_k |r_k|, target),  eta_k = min(newton_forcing, |r_k| / |r_0|)
+ *
+ * so the outer convergence becomes superlinear when approaching the solution. iter counts the Newton steps, the
+ * maximum number of inner iterations per step is n_it as well. With mixed boundary conditions the macroscale
+ * gradient is updated after every Newton step with the stress of the new iterate, i.e. it is not part of the
+ * linearization.
+ */
+template <int howmany, typename real_t = double>
+class SolverNewtonCG : public SolverCG<howmany, real_t> {
+  public:
+    using Solver<howmany, real_t>::n_x;
+    using Solver<howmany, real_t>::n_y;
+    using Solver<howmany, real_t>::n_z;
+    using Solver<howmany, real_t>::local_n0;
+    using Solver<howmany, real_t>::v_u_real;
+    using Solver<howmany, real_t>::v_r_real;
+    using SolverCG<howmany, real_t>::s_real;
+    using SolverCG<howmany, real_t>::d_real;
+    using SolverCG<howmany, real_t>::rnew_real;
+
+    SolverNewtonCG(Reader reader, Matmodel<howmany> *matmodel);
+
+    void internalSolve();
+    bool residualAtSolution() const override
+    {
+        return true;
+    }
+
+  protected:
+    using Solver<howmany, real_t>::iter;
+
+    const double forcing; //!< Upper bound of the relative inner tolerance ("newton_forcing")
+    real_t      *u_lin;   //!< Displacement of the linearization point including the halo layer
+
+    int solveLinearized(double tol); //!< Inner CG, returns the number of iterations
+};
+
+template <int howmany, typename real_t>
+SolverNewtonCG<howmany, real_t>::SolverNewtonCG(Reader reader, Matmodel<howmany> *mat)
+    : SolverCG<howmany, real_t>(reader, mat),
+      forcing(reader.newton_forcing),
+      u_lin(FFTWTraits<real_t>::alloc_real((local_n0 + 1) * n_y * n_z * howmany))
+{
+    if (dynamic_cast<LinearModel<howmany> *>(mat) == nullptr && !mat->has_tangent())
+        throw std::invalid_argument(reader.matmodel + " does not provide a consistent tangent as required by the method newton_cg");
+}
+
+template <int howmany, typename real_t>
+int SolverNewtonCG<howmany, real_t>::solveLinearized(double tol)
+{
+    LinearModel<howmany> *linearModel = dynamic_cast<LinearModel<howmany> *>(this->matmodel);
+    Matmodel<howmany>    *matmodel    = this->matmodel;
+
+    // rnew = K_t(u_lin) d
+    auto tangent_product = [&](Matrix<double, howmany * 8, 1> &ue, Matrix<double, howmany * 8, 1> &res_e, int mat_index, ptrdiff_t element_idx) {
+        if (linearModel != nullptr) {
+            res_e.noalias() = linearModel->phase_stiffness[mat_index] * ue;
+            return;
+        }
+        ptrdiff_t idx[8], idxPadding[8];
+        this->template elementNodes<0>(element_idx, idx, idxPadding);
+        Matrix<double, howmany * 8, 1> ue_lin;
+        for (int i = 0; i < 8; i++) {
+            for (int j = 0; j < howmany; j++) {
+                ue_lin(howmany * i + j, 0) = (double) u_lin[howmany * idx[i] + j] - (double) u_lin[howmany * idx[0] + j];
+            }
+        }
+        typename Matmodel<howmany>::Workspace ws;
+        matmodel->element_tangent_product(ue_lin, ue, mat_index, element_idx, res_e, ws);
+    };
+
+    // the same iteration as the linear path of SolverCG, with v_r = r(u_lin) + K_t (v_u - u_lin)
+    s_real.setZero();
+    d_real.setZero();
+    double delta = 1.0, delta0, deltamid;
+    int    inner = 0;
+    while (inner < this->n_it && this->residual_norm(v_r_real) > tol) {
+        deltamid = this->dotProduct(v_r_real, s_real);
+        this->convolution();
+        s_real *= -1;
+        delta0 = delta;
+        delta  = this->dotProduct(v_r_real, s_real);
+
+        d_real = s_real + (real_t) fmax(0, (delta - deltamid) / delta0) * d_real;
+
+        this->template compute_residual_basic<0, true>(rnew_real, d_real, tangent_product);
+
+        double alpha = delta / this->dotProduct(d_real, rnew_real);
+        v_r_real -= (real_t) alpha * rnew_real;
+        v_u_real -= (real_t) alpha * d_real;
+        inner++;
+    }
+    return inner;
+}
+
+template <int howmany, typename real_t>
+void SolverNewtonCG<howmany, real_t>::internalSolve()
+{
+    if (this->world_rank == 0)
+        printf("\n# Start FANS - Newton Conjugate Gradient Solver \n");
+
+    const bool islinear = dynamic_cast<LinearModel<howmany> *>(this->matmodel) != nullptr && !this->isMixedBCActive();
+    const bool relative = this->reader.errorParameters["type"].template get<std::string>() == "relative";
+
+    this->template compute_residual<2>(v_r_real, v_u_real);
+
+    iter           = 0;
+    double err_rel = this->compute_error(v_r_real);
+    double err0    = this->err_all[0];
+    double target  = relative ? this->TOL * err0 : this->TOL;
+
+    while ((iter < this->n_it) && (err_rel > this->TOL)) {
+        // the halo layer of v_u has been filled by compute_residual
+        std::copy(this->v_u, this->v_u + (local_n0 + 1) * n_y * n_z * howmany, u_lin);
+
+        const double err   = this->err_all[iter];
+        const double eta   = islinear ? 0.0 : std::min(forcing, err / err0);
+        const int    inner = solveLinearized(std::max(eta * err, target));
+
+        this->updateMixedBC();
+        this->template compute_residual<2>(v_r_real, v_u_real);
+        if (this->world_rank == 0)
+            printf("newton step with %i cg iterations - ", inner);
+
+        iter++;
+        err_rel = this->compute_error(v_r_real);
+    }
+    if (this->world_rank == 0)
+        printf("# Complete FANS - Newton Conjugate Gradient Solver \n");
+}
+#endif
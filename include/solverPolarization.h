@@ -0,0 +1,210 @@
+#ifndef SOLVER_POLARIZATION_H
+#define SOLVER_POLARIZATION_H
+
+#include "solver.h"
+
+/**
+ * @brief Polarization schemes "eyre_milton" and "admm": Peaceman-Rachford and Douglas-Rachford splitting of
+ * compatibility and constitutive law for the Gauss point field x = eps + C0^-1 sigma(eps), C0 = c kapparef_mat.
+ * eps and y are stored at all Gauss points.
+ */
+template <int howmany, typename real_t = double>
+class SolverPolarization : public Solver<howmany, real_t> {
+  public:
+    using Solver<howmany, real_t>::n_x;
+    using Solver<howmany, real_t>::n_y;
+    using Solver<howmany, real_t>::n_z;
+    using Solver<howmany, real_t>::local_n0;
+    using Solver<howmany, real_t>::local_n1;
+    using Solver<howmany, real_t>::v_u_real;
+    using Solver<howmany, real_t>::v_r_real;
+
+    static const int n_str = Matmodel<howmany>::n_str;
+    typedef Matrix<double, n_str, n_str> StrMatrix;
+    typedef Matrix<double, n_str * 8, 1> GaussVector;
+
+    SolverPolarization(Reader reader, Matmodel<howmany> *matmodel);
+    ~SolverPolarization();
+
+    void internalSolve();
+    bool residualAtSolution() const override
+    {
+        return true;
+    }
+
+  protected:
+    using Solver<howmany, real_t>::iter;
+
+    const double lambda;   //!< Relaxation of the splitting, 2 for Eyre-Milton, 1 for ADMM
+    const bool   islinear; //!< The resolvent is linear and precomputed per phase
+    double       c;        //!< Scaling of kapparef_mat to the reference stiffness
+    StrMatrix    C0;       //!< Reference stiffness c kapparef_mat
+    StrMatrix    C0_inv;   //!< Inverse of the reference stiffness
+    double      *eps;      //!< Strain of the resolvent at the Gauss points, element after element
+    double      *y;        //!< Reflected field 2 eps - x at the Gauss points
+    std::vector<StrMatrix, Eigen::aligned_allocator<StrMatrix>> resolvent; //!< (C + C0)^-1 C0 per phase for linear models
+    typename Matmodel<howmany>::StiffnessList                   C_phase;   //!< Phase stiffnesses before the first time step
+
+    static constexpr int    newton_max_iter = 20;
+    static constexpr double newton_tol      = 1e-12;
+
+    void setupReference();
+    void referenceMediumChanged() override
+    {
+        setupReference();
+    }
+    void polarizationStep(const Matrix<double, howmany * 8, 1> &ue, Matrix<double, howmany * 8, 1> &res_e, int mat_index, ptrdiff_t element_idx, bool first);
+    void solveResolvent(const GaussVector &x, Map<GaussVector> &eps_e, int mat_index, ptrdiff_t element_idx);
+};
+
+template <int howmany, typename real_t>
+SolverPolarization<howmany, real_t>::SolverPolarization(Reader reader, Matmodel<howmany> *mat)
+    : Solver<howmany, real_t>(reader, mat),
+      lambda(reader.method == "eyre_milton" ? 2.0 : 1.0),
+      islinear(dynamic_cast<LinearModel<howmany> *>(mat) != nullptr)
+{
+    this->CreateFFTWPlans(this->v_r, (typename FFTWTraits<real_t>::complex *) this->v_r, this->v_r);
+
+    if (!islinear && !mat->has_tangent())
+        throw std::invalid_argument(reader.matmodel + " does not provide a consistent tangent as required by the method " + reader.method);
+
+    C_phase = mat->initial_stiffness();
+    setupReference();
+
+    const size_t n_values = static_cast<size_t>(local_n0 * n_y * n_z) * 8 * n_str;
+    eps                   = FANS_malloc<double>(n_values);
+    y                     = FANS_malloc<double>(n_values);
+}
+
+template <int howmany, typename real_t>
+SolverPolarization<howmany, real_t>::~SolverPolarization()
+{
+    FANS_free(eps);
+    FANS_free(y);
+}
+
+// Scaling of the reference and resolvents of the linear phases, called again when the reference medium changes
+template <int howmany, typename real_t>
+void SolverPolarization<howmany, real_t>::setupReference()
+{
+    const Vector2d bounds = this->matmodel->relative_stiffness_bounds(C_phase);
+    // void phases would give C0 = 0, their contrast is bounded by 1e-6 instead
+    c      = sqrt(std::max(bounds(0), 1e-6 * bounds(1)) * bounds(1));
+    C0     = c * this->matmodel->kapparef_mat;
+    C0_inv = C0.inverse();
+
+    if (islinear) {
+        resolvent.resize(this->matmodel->n_mat);
+        for (int i = 0; i < this->matmodel->n_mat; ++i)
+            resolvent[i] = (C_phase[i] + C0).inverse() * C0;
+    }
+    if (this->world_rank == 0)
+        printf("# Reference stiffness of the polarization scheme: %e * kapparef_mat\n", c);
+}
+
+// eps_e = R(x): Newton's method for sigma(eps) + C0 (eps - x) = 0 at the 8 Gauss points of an element
+template <int howmany, typename real_t>
+void SolverPolarization<howmany, real_t>::solveResolvent(const GaussVector &x, Map<GaussVector> &eps_e, int mat_index, ptrdiff_t element_idx)
+{
+    if (islinear) {
+        for (int p = 0; p < 8; ++p)
+            eps_e.template segment<n_str>(n_str * p).noalias() = resolvent[mat_index] * x.template segment<n_str>(n_str * p);
+        return;
+    }
+
+    GaussVector                      sigma, res;
+    Matrix<double, n_str, n_str * 8> tangent;
+    double                           scale = 0.0;
+    for (int p = 0; p < 8; ++p)
+        scale = std::max(scale, (C0 * x.template segment<n_str>(n_str * p)).norm());
+
+    for (int it = 0; it < newton_max_iter; ++it) {
+        this->matmodel->get_sigma(eps_e.data(), sigma.data(), 8, mat_index, 8 * element_idx);
+        double res_max = 0.0;
+        for (int p = 0; p < 8; ++p) {
+            res.template segment<n_str>(n_str * p) = sigma.template segment<n_str>(n_str * p) + C0 * (eps_e.template segment<n_str>(n_str * p) - x.template segment<n_str>(n_str * p));
+            res_max                                = std::max(res_max, res.template segment<n_str>(n_str * p).norm());
+        }
+        if (res_max <= newton_tol * scale)
+            return;
+
+        this->matmodel->get_tangent(eps_e.data(), tangent.data(), 8, mat_index, 8 * element_idx);
+        for (int p = 0; p < 8; ++p) {
+            const StrMatrix J = tangent.template block<n_str, n_str>(0, n_str * p) + C0;
+            eps_e.template segment<n_str>(n_str * p) -= J.ldlt().solve(res.template segment<n_str>(n_str * p));
+        }
+    }
+}
+
+// Completes the previous iteration with the displacement ue = K0^-1 B^T C0 y / c of the element, then evaluates the
+// resolvent for the new x and returns the element residual B^T C0 y / c of the new reflected field
+template <int howmany, typename real_t>
+void SolverPolarization<howmany, real_t>::polarizationStep(const Matrix<double, howmany * 8, 1> &ue, Matrix<double, howmany * 8, 1> &res_e, int mat_index, ptrdiff_t element_idx, bool first)
+{
+    Map<GaussVector> eps_e(eps + 8 * n_str * element_idx);
+    Map<GaussVector> y_e(y + 8 * n_str * element_idx);
+    GaussVector      compatible, x;
+    this->matmodel->element_gradient(ue, compatible);
+
+    if (first) {
+        // start from the compatible strain, x = eps + C0^-1 sigma(eps) and R(x) = eps
+        GaussVector sigma;
+        this->matmodel->get_sigma(compatible.data(), sigma.data(), 8, mat_index, 8 * element_idx);
+        eps_e = compatible;
+        for (int p = 0; p < 8; ++p)
+            y_e.template segment<n_str>(n_str * p) = compatible.template segment<n_str>(n_str * p) - C0_inv * sigma.template segment<n_str>(n_str * p);
+    } else {
+        x = (1.0 - 0.5 * lambda) * (2.0 * eps_e - y_e) + 0.5 * lambda * (2.0 * compatible - y_e);
+        solveResolvent(x, eps_e, mat_index, element_idx);
+        y_e = 2.0 * eps_e - x;
+    }
+
+    // the flux of the projection with kapparef_mat, as the Green operator is not scaled
+    GaussVector flux;
+    for (int p = 0; p < 8; ++p)
+        flux.template segment<n_str>(n_str * p).noalias() = this->matmodel->kapparef_mat * y_e.template segment<n_str>(n_str * p);
+    this->matmodel->element_divergence(flux, res_e);
+}
+
+// x_{k+1} = (1 - lambda / 2) x_k + lambda / 2 (2 (E + Gamma0 y_k) - y_k) with y_k = 2 R(x_k) - x_k, lambda = 2 for
+// Eyre-Milton and 1 for ADMM. v_u is the displacement of Gamma0 y_k, the residual is evaluated for it as for the other
+// methods.
+template <int howmany, typename real_t>
+void SolverPolarization<howmany, real_t>::internalSolve()
+{
+    if (this->world_rank == 0)
+        printf("\n# Start FANS - Polarization Solver (%s) \n", lambda == 2.0 ? "Eyre-Milton" : "ADMM");
+
+    this->template compute_residual<2>(v_r_real, v_u_real);
+
+    iter           = 0;
+    double err_rel = this->compute_error(v_r_real);
+    bool   first   = true;
+
+    while ((iter < this->n_it) && (err_rel > this->TOL)) {
+
+        this->template compute_residual_basic<2, true>(v_r_real, v_u_real, [&](Matrix<double, howmany * 8, 1> &ue, Matrix<double, howmany * 8, 1> &res_e, int mat_index, ptrdiff_t element_idx) {
+            polarizationStep(ue, res_e, mat_index, element_idx, first);
+        });
+        first = false;
+
+        // the macroscale part of the projection, the fluctuation follows from the convolution
+        if (this->isMixedBCActive()) {
+            VectorXd y_mean = Map<Matrix<double, n_str, Dynamic>>(y, n_str, local_n0 * n_y * n_z * 8).rowwise().sum();
+            double   time   = MPI_Wtime();
+            MPI_Allreduce(MPI_IN_PLACE, y_mean.data(), n_str, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            Timer::add("allreduce", MPI_Wtime() - time);
+            this->updateMixedBCPolarization(y_mean / (8.0 * n_x * n_y * n_z), c);
+        }
+
+        this->convolution();
+        v_u_real = v_r_real;
+        this->template compute_residual<2>(v_r_real, v_u_real);
+
+        iter++;
+        err_rel = this->compute_error(v_r_real);
+    }
+    if (this->world_rank == 0)
+        printf("# Complete FANS - Polarization Solver \n");
+}
+#endif
@@ -0,0 +1,363 @@
+#ifndef SOLVER_TANGENT_H
+#define SOLVER_TANGENT_H
+
+#include "solver.h"
+
+/**
+ * @brief Homogenized tangent of the current state of a solver from n_str linearized problems solved at once.
+ *
+ * Column k of the tangent is the average of C_t (e_k + B du_k), where du_k solves the linearized problem
+ *
+ *     B^T C_t B du_k = -B^T C_t e_k
+ *
+ * with the consistent tangent C_t at the converged displacement of the solver, or the phase stiffness for linear
+ * models. The n_str problems are stored interleaved with n_rhs = howmany * n_str values per node: one FFTW plan with
+ * howmany = n_rhs transforms all of them, every block of the Green operator is applied to the n_str load directions of
+ * its mode, and the tangent of an element is evaluated once for all directions. The problems are solved in lockstep by
+ * the preconditioned CG method in the variant of Chronopoulos and Gear, which needs a single reduction per iteration:
+ * the dot products and residual norms of all directions share one MPI_Allreduce. A direction stops updating once its
+ * relative residual (L2) is below max(1e-6, TOL).
+ * Neither the fields nor the internal variables of the solver are modified. The six fields of n_rhs values per node
+ * are allocated on first use and kept for the following calls.
+ */
+template <int howmany, typename real_t = double>
+class TangentSolver {
+  public:
+    static const int n_str = Matmodel<howmany>::n_str;
+    static const int n_rhs = howmany * n_str; //!< Values per node, the load directions of every node are contiguous
+
+    typedef Matrix<double, howmany * 8, n_str> ElementBlock; //!< Element displacements of all load directions
+    typedef Matrix<double, n_str * 8, n_str>   GaussBlock;   //!< Gradients or fluxes of all load directions
+    typedef Matrix<double, n_str, n_str * 8>   TangentBlock; //!< Tangent at the Gauss points, one block per point
+    typedef Map<Array<real_t, n_rhs, Dynamic>> LineArray;    //!< The nodes of one z-line of a field
+    typedef Array<real_t, n_rhs, 1>            Coefficients; //!< Scalars of the load directions repeated per value
+
+    TangentSolver(Solver<howmany, real_t> &solver);
+    ~TangentSolver();
+
+    MatrixXd solve();
+
+  private:
+    Solver<howmany, real_t> &solver;
+    Matmodel<howmany>       *matmodel;
+    LinearModel<howmany>    *linearModel; //!< Set for linear models, whose products use the phase stiffness
+    const ptrdiff_t          n_x, n_y, n_z, local_n0, local_n1, local_1_start;
+    const ptrdiff_t          slab; //!< Values of an x-slab of a field including the padding
+
+    real_t *r; //!< Residual, input of the forward FFT
+    real_t *s; //!< Preconditioned residual, output of the FFTs
+    real_t *w; //!< Tangent times s
+    real_t *q; //!< Tangent times d
+    real_t *d; //!< Search directions
+    real_t *u; //!< Displacement fluctuations du
+    real_t *buffer_padding;
+
+    typename FFTWTraits<real_t>::plan planfft, planifft;
+    typename Matmodel<howmany>::StiffnessList C_phase;
+
+    LineArray line(real_t *f, ptrdiff_t i) const
+    {
+        return LineArray(f + i * (n_z + 2) * n_rhs, n_rhs, n_z);
+    }
+    void exchangeHalo(real_t *f);
+    void elementTangent(ptrdiff_t *idx, int mat_index, TangentBlock &tangent) const;
+    template <typename F>
+    void assemble(real_t *out, real_t *in, F f);
+    void precondition();
+};
+
+template <int howmany, typename real_t>
+TangentSolver<howmany, real_t>::TangentSolver(Solver<howmany, real_t> &solver)
+    : solver(solver),
+      matmodel(solver.matmodel),
+      linearModel(dynamic_cast<LinearModel<howmany> *>(solver.matmodel)),
+      n_x(solver.n_x),
+      n_y(solver.n_y),
+      n_z(solver.n_z),
+      local_n0(solver.local_n0),
+      local_n1(solver.local_n1),
+      local_1_start(solver.local_1_start),
+      slab(solver.n_y * (solver.n_z + 2) * n_rhs)
+{
+    int             rank   = 3;
+    ptrdiff_t       iblock = FFTW_MPI_DEFAULT_BLOCK;
+    ptrdiff_t       oblock = FFTW_MPI_DEFAULT_BLOCK;
+    const ptrdiff_t n[3]   = {n_x, n_y, n_z};
+
+    // the distribution does not depend on howmany, only the size of the transposition buffers
+    const ptrdiff_t n_complex[3] = {n_x, n_y, n_z / 2 + 1};
+    ptrdiff_t       ln0, l0s, ln1, l1s;
+    const ptrdiff_t alloc_local = fftw_mpi_local_size_many_transposed(rank, n_complex, n_rhs, iblock, oblock, MPI_COMM_WORLD, &ln0, &l0s, &ln1, &l1s);
+    const ptrdiff_t n_values    = std::max(alloc_local * 2, (local_n0 + 1) * slab);
+
+    r              = FFTWTraits<real_t>::alloc_real(n_values);
+    s              = FFTWTraits<real_t>::alloc_real(n_values);
+    w              = FFTWTraits<real_t>::alloc_real(n_values);
+    q              = FFTWTraits<real_t>::alloc_real(n_values);
+    d              = FFTWTraits<real_t>::alloc_real(n_values);
+    u              = FFTWTraits<real_t>::alloc_real(n_values);
+    buffer_padding = FFTWTraits<real_t>::alloc_real(slab);
+
+    // wisdom_only has no wisdom for this number of transforms
+    unsigned flags = fftwPlannerFlags(solver.reader.fftw_planner);
+    if (flags == FFTW_WISDOM_ONLY) {
+        flags = FFTW_ESTIMATE;
+    }
+    {
+        TimedRegion timed("fftw_planning");
+        planfft  = FFTWTraits<real_t>::mpi_plan_many_dft_r2c(rank, n, n_rhs, iblock, oblock, r, (typename FFTWTraits<real_t>::complex *) s, MPI_COMM_WORLD, flags | FFTW_MPI_TRANSPOSED_OUT);
+        planifft = FFTWTraits<real_t>::mpi_plan_many_dft_c2r(rank, n, n_rhs, iblock, oblock, (typename FFTWTraits<real_t>::complex *) s, s, MPI_COMM_WORLD, flags | FFTW_MPI_TRANSPOSED_IN);
+    }
+    if (planfft == NULL || planifft == NULL) {
+        throw std::runtime_error("FFTW could not create the plans of the homogenized tangent");
+    }
+}
+
+template <int howmany, typename real_t>
+TangentSolver<howmany, real_t>::~TangentSolver()
+{
+    FFTWTraits<real_t>::destroy_plan(planfft);
+    FFTWTraits<real_t>::destroy_plan(planifft);
+    for (real_t *f : {r, s, w, q, d, u, buffer_padding}) {
+        FFTWTraits<real_t>::free(f);
+    }
+}
+
+// Copies the first x-slab of f into the halo slab of the previous process
+template <int howmany, typename real_t>
+void TangentSolver<howmany, real_t>::exchangeHalo(real_t *f)
+{
+    const int    world_rank = solver.world_rank;
+    const int    world_size = solver.world_size;
+    const double time       = MPI_Wtime();
+    MPI_Sendrecv(f, slab, FFTWTraits<real_t>::mpi_type(), (world_rank + world_size - 1) % world_size, 0,
+                 f + local_n0 * slab, slab, FFTWTraits<real_t>::mpi_type(), (world_rank + 1) % world_size, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    Timer::add("halo_exchange", MPI_Wtime() - time);
+}
+
+// Tangent at the Gauss points of an element, idx are the node indices without padding
+template <int howmany, typename real_t>
+void TangentSolver<howmany, real_t>::elementTangent(ptrdiff_t *idx, int mat_index, TangentBlock &tangent) const
+{
+    if (linearModel != nullptr) {
+        for (int p = 0; p < 8; ++p) {
+            tangent.template block<n_str, n_str>(0, n_str * p) = C_phase[mat_index];
+        }
+        return;
+    }
+    Matrix<double, howmany * 8, 1> ue;
+    Matrix<double, n_str * 8, 1>   eps;
+    for (int i = 0; i < 8; ++i) {
+        for (int j = 0; j < howmany; ++j) {
+            ue(howmany * i + j, 0) = (double) solver.v_u[howmany * idx[i] + j] - (double) solver.v_u[howmany * idx[0] + j];
+        }
+    }
+    matmodel->element_gradient(ue, eps);
+    matmodel->get_tangent(eps.data(), tangent.data(), 8, mat_index, 8 * idx[0]);
+}
+
+// out = sum of the element blocks f(idx, due, res_e) with the element displacements due of in (nullptr: zero), the
+// same element loops and halo handling as Solver::compute_residual_basic on the padded layout of all fields
+template <int howmany, typename real_t>
+template <typename F>
+void TangentSolver<howmany, real_t>::assemble(real_t *out, real_t *in, F f)
+{
+    std::fill(out, out + (local_n0 + 1) * slab, (real_t) 0);
+
+    auto element = [&](ptrdiff_t *idx, ptrdiff_t *idxPadding) {
+        ElementBlock due, res_e; // thread-local
+        if (in != nullptr) {
+            for (int i = 0; i < 8; i++) {
+                for (int k = 0; k < n_str; k++) {
+                    for (int j = 0; j < howmany; j++) {
+                        due(howmany * i + j, k) = (double) in[n_rhs * idxPadding[i] + howmany * k + j] - (double) in[n_rhs * idxPadding[0] + howmany * k + j];
+                    }
+                }
+            }
+        }
+        f(idx, due, res_e);
+        for (int i = 0; i < 8; i++) {
+            for (int k = 0; k < n_str; k++) {
+                for (int j = 0; j < howmany; j++) {
+                    out[n_rhs * idxPadding[i] + howmany * k + j] += res_e(howmany * i + j, k);
+                }
+            }
+        }
+    };
+    solver.template assembleWithHalo<2>(in, slab, out, slab, buffer_padding, element, true);
+    for (ptrdiff_t i = 0; i < slab; ++i) {
+        out[i] += buffer_padding[i];
+    }
+}
+
+// s = G r with the Green operator of the solver, applied to every load direction of a mode
+template <int howmany, typename real_t>
+void TangentSolver<howmany, real_t>::precondition()
+{
+    double time = MPI_Wtime();
+    FFTWTraits<real_t>::execute(planfft);
+    Timer::add("fft_forward", MPI_Wtime() - time);
+
+    time                    = MPI_Wtime();
+    std::complex<real_t> *x = (std::complex<real_t> *) s;
+    if (solver.green_on_the_fly) {
+#pragma omp parallel for collapse(2) schedule(static)
+        for (ptrdiff_t i_y = 0; i_y < local_n1; ++i_y) {
+            for (ptrdiff_t i_x = 0; i_x < n_x; ++i_x) {
+                for (ptrdiff_t i_z = 0; i_z < n_z / 2 + 1; ++i_z) {
+                    ptrdiff_t ind = i_y * n_x * (n_z / 2 + 1) + i_x * (n_z / 2 + 1) + i_z;
+                    if (i_x != 0 || (local_1_start + i_y) != 0 || i_z != 0) {
+                        const Matrix<double, howmany, howmany> G = solver.greenBlock(i_x, i_y, i_z);
+                        for (int k = 0; k < n_str; ++k) {
+                            applyGreenBlock<howmany, Lower>(G.data(), x + ind * n_rhs + howmany * k);
+                        }
+                    } else {
+                        std::fill(x + ind * n_rhs, x + (ind + 1) * n_rhs, std::complex<real_t>(0));
+                    }
+                }
+            }
+        }
+    } else {
+        const real_t *G = solver.fundamentalSolution.data();
+#pragma omp parallel for schedule(static)
+        for (ptrdiff_t i = 0; i < (local_n1 * n_x * (n_z / 2 + 1)) / 2; i++) {
+            const real_t *G_even = G + i * (howmany + 1) * howmany;
+            const real_t *G_odd  = G + (i * (howmany + 1) + 1) * howmany;
+            for (int k = 0; k < n_str; ++k) {
+                applyGreenBlock<howmany, Lower>(G_even, x + 2 * i * n_rhs + howmany * k);
+                applyGreenBlock<howmany, Upper>(G_odd, x + (2 * i + 1) * n_rhs + howmany * k);
+            }
+        }
+    }
+    Timer::add("convolution", MPI_Wtime() - time);
+
+    time = MPI_Wtime();
+    FFTWTraits<real_t>::execute(planifft);
+    Timer::add("fft_inverse", MPI_Wtime() - time);
+}
+
+template <int howmany, typename real_t>
+MatrixXd TangentSolver<howmany, real_t>::solve()
+{
+    const int world_rank = solver.world_rank;
+    const int world_size = solver.world_size;
+    C_phase              = matmodel->initial_stiffness();
+
+    // the linearization point, v_u is only read
+    MPI_Sendrecv(solver.v_u, n_y * n_z * howmany, FFTWTraits<real_t>::mpi_type(), (world_rank + world_size - 1) % world_size, 0,
+                 solver.v_u + local_n0 * n_y * n_z * howmany, n_y * n_z * howmany, FFTWTraits<real_t>::mpi_type(), (world_rank + 1) % world_size, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+    // r = -B^T C_t e_k, i.e. the unit gradients are the columns of the flux increment
+    assemble(r, nullptr, [&](ptrdiff_t *idx, const ElementBlock &, ElementBlock &res_e) {
+        TangentBlock tangent;
+        GaussBlock   sigma;
+        elementTangent(idx, solver.ms[idx[0]], tangent);
+        for (int p = 0; p < 8; ++p) {
+            sigma.template middleRows<n_str>(n_str * p) = -tangent.template block<n_str, n_str>(0, n_str * p);
+        }
+        matmodel->element_divergence(sigma, res_e);
+    });
+    auto tangent_product = [&](ptrdiff_t *idx, const ElementBlock &due, ElementBlock &res_e) {
+        const int mat_index = solver.ms[idx[0]];
+        if (linearModel != nullptr) {
+            res_e.noalias() = linearModel->phase_stiffness[mat_index] * due;
+            return;
+        }
+        TangentBlock tangent;
+        GaussBlock   deps, sigma;
+        elementTangent(idx, mat_index, tangent);
+        matmodel->element_gradient_increment(due, deps);
+        for (int p = 0; p < 8; ++p) {
+            sigma.template middleRows<n_str>(n_str * p).noalias() = tangent.template block<n_str, n_str>(0, n_str * p) * deps.template middleRows<n_str>(n_str * p);
+        }
+        matmodel->element_divergence(sigma, res_e);
+    };
+
+    const ptrdiff_t n_lines = local_n0 * n_y;
+    for (real_t *f : {q, d, u}) {
+        std::fill(f, f + (local_n0 + 1) * slab, (real_t) 0);
+    }
+
+    const double tol = std::max(1e-6, solver.TOL);
+    Array<double, n_str, 1>  gamma, delta, rho, beta;
+    Array<double, n_str, 1>  gamma_old = Array<double, n_str, 1>::Zero(), alpha = gamma_old, rho0 = gamma_old;
+    Array<bool, n_str, 1>    active;
+    Coefficients             alpha_r, beta_r;
+    Matrix<double, n_rhs, 3> local;
+    int                      iter = 0;
+    for (; iter < solver.n_it; ++iter) {
+        precondition();
+        assemble(w, s, tangent_product);
+
+        // gamma = (r, s), delta = (w, s) and rho = (r, r) of all directions in one reduction
+        local.setZero();
+        for (ptrdiff_t i = 0; i < n_lines; ++i) {
+            const LineArray R = line(r, i), S = line(s, i), W = line(w, i);
+            local.col(0) += (R.template cast<double>() * S.template cast<double>()).rowwise().sum().matrix();
+            local.col(1) += (W.template cast<double>() * S.template cast<double>()).rowwise().sum().matrix();
+            local.col(2) += R.template cast<double>().square().rowwise().sum().matrix();
+        }
+        Matrix<double, 1, 3 * n_str> sums = Map<Matrix<double, howmany, 3 * n_str>>(local.data()).colwise().sum();
+        double                       time = MPI_Wtime();
+        MPI_Allreduce(MPI_IN_PLACE, sums.data(), 3 * n_str, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        Timer::add("allreduce", MPI_Wtime() - time);
+        gamma = sums.template segment<n_str>(0).transpose().array();
+        delta = sums.template segment<n_str>(n_str).transpose().array();
+        rho   = sums.template segment<n_str>(2 * n_str).transpose().array();
+
+        if (iter == 0) {
+            rho0 = rho;
+        }
+        active = rho > tol * tol * rho0;
+        if (!active.any()) {
+            break;
+        }
+        for (int k = 0; k < n_str; ++k) {
+            beta(k)  = (iter == 0 || !active(k)) ? 0.0 : gamma(k) / gamma_old(k);
+            alpha(k) = !active(k) ? 0.0 : gamma(k) / (delta(k) - (iter == 0 ? 0.0 : beta(k) * gamma(k) / alpha(k)));
+            alpha_r.template segment<howmany>(howmany * k).setConstant((real_t) alpha(k));
+            beta_r.template segment<howmany>(howmany * k).setConstant((real_t) beta(k));
+        }
+        gamma_old = gamma;
+
+        // d = s + beta d, q = w + beta q, u += alpha d, r -= alpha q in one sweep
+        for (ptrdiff_t i = 0; i < n_lines; ++i) {
+            LineArray D = line(d, i), Q = line(q, i), U = line(u, i), R = line(r, i);
+            D = line(s, i) + D.colwise() * beta_r;
+            Q = line(w, i) + Q.colwise() * beta_r;
+            U += D.colwise() * alpha_r;
+            R -= Q.colwise() * alpha_r;
+        }
+    }
+
+    // column k is the average of C_t (e_k + B du_k)
+    exchangeHalo(u);
+    MatrixXd tangent_sum = MatrixXd::Zero(n_str, n_str);
+    solver.template iterateCubes<2>([&](ptrdiff_t *idx, ptrdiff_t *idxPadding) {
+        ElementBlock due;
+        TangentBlock tangent;
+        GaussBlock   deps;
+        for (int i = 0; i < 8; i++) {
+            for (int k = 0; k < n_str; k++) {
+                for (int j = 0; j < howmany; j++) {
+                    due(howmany * i + j, k) = (double) u[n_rhs * idxPadding[i] + howmany * k + j] - (double) u[n_rhs * idxPadding[0] + howmany * k + j];
+                }
+            }
+        }
+        elementTangent(idx, solver.ms[idx[0]], tangent);
+        matmodel->element_gradient_increment(due, deps);
+        for (int p = 0; p < 8; ++p) {
+            const Matrix<double, n_str, n_str> C_p = tangent.template block<n_str, n_str>(0, n_str * p);
+            tangent_sum += 0.125 * C_p * (Matrix<double, n_str, n_str>::Identity() + deps.template middleRows<n_str>(n_str * p));
+        }
+    });
+    double time = MPI_Wtime();
+    MPI_Allreduce(MPI_IN_PLACE, tangent_sum.data(), n_str * n_str, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    Timer::add("allreduce", MPI_Wtime() - time);
+
+    if (world_rank == 0) {
+        printf("# Homogenized tangent: %i iterations of %i load directions, max. relative residual %e\n", iter, n_str, sqrt((rho0 > 0).select(rho / rho0, 0.0).maxCoeff()));
+    }
+    return tangent_sum / (double) (n_x * n_y * n_z);
+}
+#endif
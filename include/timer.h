@@ -0,0 +1,116 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+// ============================================================================
+//  timer.h
+//  --------------------------------------------------------------------------
+//  • Wall-clock timing of named code regions (MPI_Wtime)
+//  • Regions may be nested, every region reports its inclusive time
+//  • Only the main thread of each rank may record times (regions enclose the
+//    OpenMP parallel loops, they are never opened inside of them)
+//  • writeReport() reduces min / max / avg over all ranks into a JSON file
+// ============================================================================
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include "mpi.h"
+#include <json.hpp>
+
+class Timer {
+  public:
+    struct Region {
+        double seconds = 0.0;
+        long   calls   = 0;
+    };
+
+    static void add(const std::string &name, double seconds)
+    {
+        Region &region = regions()[name];
+        region.seconds += seconds;
+        region.calls++;
+    }
+
+    static void reset()
+    {
+        regions().clear();
+    }
+
+    // Collective over comm. Ranks may have recorded different regions (e.g. only rank 0 writes some results),
+    // so the union of all region names is formed first, then every region is reduced in the same (sorted) order.
+    static void writeReport(const std::string &filename, MPI_Comm comm, const nlohmann::json &info = nlohmann::json::object())
+    {
+        int rank, size;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        std::string names;
+        for (const auto &region : regions())
+            names += region.first + '\n';
+        int              length = names.size();
+        std::vector<int> lengths(size), offsets(size, 0);
+        MPI_Allgather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, comm);
+        for (int i = 1; i < size; ++i)
+            offsets[i] = offsets[i - 1] + lengths[i - 1];
+        std::string all_names(offsets[size - 1] + lengths[size - 1], '\n');
+        MPI_Allgatherv(names.data(), length, MPI_CHAR, &all_names[0], lengths.data(), offsets.data(), MPI_CHAR, comm);
+        size_t start = 0;
+        for (size_t end = all_names.find('\n'); end != std::string::npos; start = end + 1, end = all_names.find('\n', start)) {
+            if (end > start)
+                regions()[all_names.substr(start, end - start)]; // inserts missing regions with zero time
+        }
+
+        nlohmann::json report = info;
+        report["n_ranks"]     = size;
+        for (const auto &region : regions()) {
+            double seconds = region.second.seconds, min, max, sum;
+            long   calls   = region.second.calls, max_calls;
+            MPI_Reduce(&seconds, &min, 1, MPI_DOUBLE, MPI_MIN, 0, comm);
+            MPI_Reduce(&seconds, &max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+            MPI_Reduce(&seconds, &sum, 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+            MPI_Reduce(&calls, &max_calls, 1, MPI_LONG, MPI_MAX, 0, comm);
+            report["regions"][region.first] = {{"calls", max_calls}, {"min", min}, {"max", max}, {"avg", sum / size}};
+        }
+
+        if (rank == 0) {
+            std::ofstream file(filename);
+            if (file) {
+                file << report.dump(4) << std::endl;
+                printf("# Performance report written to %s\n", filename.c_str());
+            } else {
+                fprintf(stderr, "WARNING: Could not write the performance report %s\n", filename.c_str());
+            }
+        }
+    }
+
+  private:
+    static std::map<std::string, Region> &regions()
+    {
+        static std::map<std::string, Region> regions;
+        return regions;
+    }
+};
+
+// Adds the wall-clock time between construction and destruction to the region "name"
+class TimedRegion {
+  public:
+    explicit TimedRegion(const char *name)
+        : name(name), start(MPI_Wtime())
+    {
+    }
+    ~TimedRegion()
+    {
+        Timer::add(name, MPI_Wtime() - start);
+    }
+    double elapsed() const
+    {
+        return MPI_Wtime() - start;
+    }
+
+  private:
+    const char  *name;
+    const double start;
+};
+
+#endif // TIMER_H
@@ -27,10 +27,11 @@ py::array_t<double> merge_arrays(py::array_t<double> array1, py::array_t<double>
 MicroSimulation::MicroSimulation(int sim_id, char *input_file)
 {
     // initialize fftw mpi
-    fftw_mpi_init();
+    initializeFFTW();
 
     // Input file name is hardcoded. TODO: Make it configurable
     reader.ReadInputFile(input_file);
+    setNumThreads(reader);
 
     reader.ReadMS(3);
     matmodel = createMatmodel<3>(reader);
@@ -6,16 +6,24 @@
 // Version
 #include "version.h"
 
-template <int howmany>
-void runSolver(Reader &reader, const char *output_file_basename)
+template <int howmany, typename real_t>
+void runLoadCases(Reader &reader, const char *output_file_basename)
 {
-    reader.ReadMS(howmany);
+    // The fundamental solution and the FFTW plans only depend on the microstructure and the reference medium,
+    // so they are set up once and shared by all load cases
+    Matmodel<howmany>       *matmodel = createMatmodel<howmany>(reader);
+    Solver<howmany, real_t> *solver   = createSolver<howmany, real_t>(reader, matmodel);
+
+    // The results file stays open for all load cases, the postprocessing of a time step only flushes it
+    reader.OpenResultsFile(output_file_basename);
 
     for (size_t load_path_idx = 0; load_path_idx < reader.load_cases.size(); ++load_path_idx) {
-        Matmodel<howmany> *matmodel = createMatmodel<howmany>(reader);
-        Solver<howmany>   *solver   = createSolver(reader, matmodel);
+        if (load_path_idx > 0) {
+            solver->reset();
+        }
 
         for (size_t time_step_idx = 0; time_step_idx < reader.load_cases[load_path_idx].n_steps; ++time_step_idx) {
+            solver->predict(reader.load_cases[load_path_idx].predictor, time_step_idx);
             if (reader.load_cases[load_path_idx].mixed) {
                 solver->enableMixedBC(reader.load_cases[load_path_idx].mbc, time_step_idx);
             } else {
@@ -25,8 +33,25 @@ void runSolver(Reader &reader, const char *output_file_basename)
             solver->solve();
             solver->postprocess(reader, output_file_basename, load_path_idx, time_step_idx);
         }
-        delete solver;
-        delete matmodel;
+    }
+    reader.CloseResultsFile();
+    delete solver;
+    delete matmodel;
+}
+
+template <int howmany>
+void runSolver(Reader &reader, const char *output_file_basename)
+{
+    reader.ReadMS(howmany);
+
+    if (reader.precision == "double") {
+        runLoadCases<howmany, double>(reader, output_file_basename);
+    } else {
+#ifdef FANS_SINGLE_PRECISION
+        runLoadCases<howmany, float>(reader, output_file_basename);
+#else
+        throw std::invalid_argument("FANS was built without single precision support, rebuild with FANS_ENABLE_SINGLE_PRECISION=ON to use precision " + reader.precision);
+#endif
     }
 }
 
@@ -42,12 +67,19 @@ int main(int argc, char *argv[])
         return 10;
     }
 
-    MPI_Init(NULL, NULL);
-    fftw_mpi_init();
+    // Only the main thread communicates, the threads are used inside the element loops and FFTW
+    int thread_support;
+    MPI_Init_thread(NULL, NULL, MPI_THREAD_FUNNELED, &thread_support);
+    initializeFFTW();
 
     Reader reader;
     reader.ReadInputFile(argv[1]);
+    if (thread_support < MPI_THREAD_FUNNELED && reader.n_threads > 1 && reader.world_rank == 0) {
+        fprintf(stderr, "WARNING: The MPI library does not provide MPI_THREAD_FUNNELED, running with %i threads per process anyway\n", reader.n_threads);
+    }
+    setNumThreads(reader);
 
+    double total_time = MPI_Wtime();
     if (reader.problemType == "thermal") {
         runSolver<1>(reader, argv[2]);
     } else if (reader.problemType == "mechanical") {
@@ -55,6 +87,23 @@ int main(int argc, char *argv[])
     } else {
         throw std::invalid_argument(reader.problemType + " is not a valid problem type");
     }
+    Timer::add("total", MPI_Wtime() - total_time);
+
+    // The performance report is written next to the results: <output file without .h5>_perf.json
+    string report_file = argv[2];
+    if (report_file.size() > 3 && report_file.compare(report_file.size() - 3, 3, ".h5") == 0) {
+        report_file.erase(report_file.size() - 3);
+    }
+    json info = {{"fans_version", PROJECT_VERSION},
+                 {"dims", reader.dims},
+                 {"problem_type", reader.problemType},
+                 {"matmodel", reader.matmodel},
+                 {"method", reader.method},
+                 {"precision", reader.precision},
+                 {"green_operator", reader.green_operator},
+                 {"reference_medium", reader.reference_medium},
+                 {"n_threads", reader.n_threads}};
+    Timer::writeReport(report_file + "_perf.json", MPI_COMM_WORLD, info);
 
     MPI_Finalize();
     return 0;
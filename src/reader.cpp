@@ -82,14 +82,61 @@ void Reader ::ReadInputFile(char fn[])
             strcpy(results_prefix, "");
         }
 
+        results_layout = j.value("results_layout", "time_steps");
+        if (results_layout != "time_steps" && results_layout != "time_series")
+            throw std::invalid_argument(results_layout + " is not a valid results_layout");
+
         errorParameters = j["error_parameters"];
         TOL             = errorParameters["tolerance"].get<double>();
         n_it            = j["n_it"].get<int>();
 
+#ifdef _OPENMP
+        n_threads = j.value("n_threads", omp_get_max_threads());
+#else
+        n_threads = j.value("n_threads", 1);
+#endif
+        if (n_threads < 1)
+            throw std::invalid_argument("n_threads must be positive");
+
         problemType = j["problem_type"].get<string>();
         matmodel    = j["matmodel"].get<string>();
         method      = j["method"].get<string>();
 
+        green_operator = j.value("green_operator", "tabulated");
+        if (green_operator != "tabulated" && green_operator != "on_the_fly")
+            throw std::invalid_argument(green_operator + " is not a valid green_operator");
+
+        reference_medium = j.value("reference_medium", "mean");
+        if (reference_medium != "mean" && reference_medium != "bounds" && reference_medium != "adaptive")
+            throw std::invalid_argument(reference_medium + " is not a valid reference_medium");
+
+        tangent_solver = j.value("tangent_solver", "batched");
+        if (tangent_solver != "batched" && tangent_solver != "sequential")
+            throw std::invalid_argument(tangent_solver + " is not a valid tangent_solver");
+
+        precision = j.value("precision", "double");
+        if (precision != "double" && precision != "single" && precision != "mixed")
+            throw std::invalid_argument(precision + " is not a valid precision");
+        // the recurrences of the pipelined method amplify the round-off, single precision stagnates far above the
+        // accuracy of cg
+        if (method == "cg_pipelined" && precision != "double")
+            throw std::invalid_argument("cg_pipelined requires \"precision\": \"double\"");
+
+        fftw_planner    = j.value("fftw_planner", "measure");
+        fftw_wisdom_dir = j.value("fftw_wisdom_dir", "");
+        if (fftw_planner != "estimate" && fftw_planner != "measure" && fftw_planner != "patient" && fftw_planner != "wisdom_only")
+            throw std::invalid_argument(fftw_planner + " is not a valid fftw_planner");
+
+        phase_sorted_elements = j.value("phase_sorted_elements", false);
+
+        anderson_depth = j.value("anderson_depth", 5);
+        if (anderson_depth < 1)
+            throw std::invalid_argument("anderson_depth must be positive");
+
+        newton_forcing = j.value("newton_forcing", 0.1);
+        if (newton_forcing <= 0 || newton_forcing >= 1)
+            throw std::invalid_argument("newton_forcing must be between 0 and 1");
+
         json j_mat     = j["material_properties"];
         resultsToWrite = j["results"].get<vector<string>>(); // Read the results_to_write field
 
@@ -116,6 +163,16 @@ void Reader ::ReadInputFile(char fn[])
             load_cases.push_back(std::move(lc));
         }
 
+        // one predictor for all load cases or one per load case
+        const json predictor = j.value("predictor", json("none"));
+        if (predictor.is_array() && predictor.size() != load_cases.size())
+            throw std::invalid_argument("predictor must have one entry per load case");
+        for (size_t i = 0; i < load_cases.size(); ++i) {
+            load_cases[i].predictor = (predictor.is_array() ? predictor[i] : predictor).get<string>();
+            if (load_cases[i].predictor != "none" && load_cases[i].predictor != "linear" && load_cases[i].predictor != "quadratic")
+                throw std::invalid_argument(load_cases[i].predictor + " is not a valid predictor");
+        }
+
         if (world_rank == 0) {
             printf("# microstructure file name: \t '%s'\n", ms_filename);
             printf("# microstructure dataset name: \t '%s'\n", ms_datasetname);
@@ -125,6 +182,8 @@ void Reader ::ReadInputFile(char fn[])
                 errorParameters["measure"].get<string>().c_str());
             printf("# FANS Tolerance: \t %10.5e\n", errorParameters["tolerance"].get<double>());
             printf("# Max iterations: \t %6i\n", n_it);
+            printf("# Threads per process: \t %6i\n", n_threads);
+            printf("# Precision: \t %s\n", precision.c_str());
         }
 
         for (auto it = j_mat.begin(); it != j_mat.end(); ++it) {
@@ -159,45 +218,68 @@ void Reader ::ReadInputFile(char fn[])
     }
 }
 
-void Reader::safe_create_group(hid_t file, const char *const name)
+void Reader::OpenResultsFile(const char *file_name)
 {
-    // no leading '/' --> exit
-    const char DELIMITER = '/';
-    if (name[0] != DELIMITER)
-        return;
-
-    // copy name to buffer
-    char buffer[4096];
-    strcpy(buffer, name);
-    char *str = buffer;
-    str       = strchr(str + 1, DELIMITER);
-    while (str != NULL) {
-        // while another / character is found
-        long int l = str - buffer; // length of substring
-        buffer[l]  = '\0';         // temporary 'end of string'
-
-        // safely create the group if needed
-        hid_t group;
-
-        /* Save old error handler */
-        herr_t (*old_func)(hid_t, void *);
-        void *old_client_data;
-        H5Eget_auto(H5E_DEFAULT, &old_func, &old_client_data);
-        /* Turn off error handling */
-        H5Eset_auto(H5E_DEFAULT, NULL, NULL);
-
-        group = H5Gopen(file, buffer, H5P_DEFAULT);
-        /* Restore previous error handler */
-        H5Eset_auto(H5E_DEFAULT, old_func, old_client_data);
-
-        if (group < 0) {
-            group = H5Gcreate(file, buffer, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        }
-        H5Gclose(group);
+    CloseResultsFile();
+    results_writer = make_shared<ResultsWriter>(file_name, dims, local_n0, local_0_start);
+}
+
+void Reader::CloseResultsFile()
+{
+    if (results_writer)
+        results_writer->Close();
+    results_writer.reset();
+}
 
-        buffer[l] = DELIMITER; // restore original string
+void Reader::FlushResultsFile()
+{
+    if (results_writer)
+        results_writer->Flush();
+}
+
+// The writer of the results file opened by OpenResultsFile, otherwise file_name is opened for this Reader
+ResultsWriter &Reader::Results(const char *file_name)
+{
+    if (!results_writer || results_writer->file_name != file_name)
+        results_writer = make_shared<ResultsWriter>(file_name, dims, local_n0, local_0_start);
+    return *results_writer;
+}
 
-        str = strchr(str + 1, DELIMITER); // find next delimiter
+// Dataset of the result name below the results group: <group>/load<i>/time_step<t>/<name> for "time_steps",
+// <group>/load<i>/<name> for "time_series"
+string Reader::result_path(int load_idx, int time_idx, const char *name) const
+{
+    char path[5096];
+    if (results_layout == "time_series") {
+        sprintf(path, "%s/load%i/%s", ms_datasetname, load_idx, name);
+    } else {
+        sprintf(path, "%s/load%i/time_step%i/%s", ms_datasetname, load_idx, time_idx, name);
+    }
+    return path;
+}
+
+hsize_t Reader::result_steps(int load_idx) const
+{
+    return load_idx < static_cast<int>(load_cases.size()) ? load_cases[load_idx].n_steps : 1;
+}
+
+// Transposes a slab from the file order [z][y][x] into the logical order [x][y][z]. For every y-plane the
+// (z, x) matrix is transposed in tiles, so that the strided reads of a tile stay in the L1 cache.
+template <typename T>
+static void transpose_zyx_to_xyz(const T *in, T *out, size_t nx, size_t ny, size_t nz)
+{
+    constexpr size_t TILE = 32;
+#pragma omp parallel for
+    for (size_t y = 0; y < ny; ++y) {
+        for (size_t x0 = 0; x0 < nx; x0 += TILE) {
+            const size_t x1 = std::min(x0 + TILE, nx);
+            for (size_t z0 = 0; z0 < nz; z0 += TILE) {
+                const size_t z1 = std::min(z0 + TILE, nz);
+                for (size_t x = x0; x < x1; ++x)
+                    for (size_t z = z0; z < z1; ++z)
+                        out[(x * ny + y) * nz + z] = in[(z * ny + y) * nx + x];
+            }
+        }
     }
 }
 
@@ -215,22 +297,28 @@ void Reader ::ReadMS(int hm)
 
     MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
     MPI_Comm_size(MPI_COMM_WORLD, &world_size);
-    MPI_Info info = MPI_INFO_NULL;
 
     // Set up file access property list with parallel I/O access
     plist_id = H5Pcreate(H5P_FILE_ACCESS);
-    // H5Pset_fapl_mpio(plist_id, MPI_COMM_WORLD, info);        // "set File Access Property List"
+#ifdef H5_HAVE_PARALLEL
+    H5Pset_fapl_mpio(plist_id, MPI_COMM_WORLD, MPI_INFO_NULL); // "set File Access Property List"
+#endif
 
     // Open the file collectively and release property list identifier.
     file_id = H5Fopen(ms_filename, H5F_ACC_RDONLY, plist_id);
     H5Pclose(plist_id);
+    if (file_id < 0)
+        throw std::runtime_error(string("[ReadMS] Could not open the microstructure file ") + ms_filename);
 
-    // Create property list for collective dataset write.
-    // plist_id = H5Pcreate(H5P_DATASET_XFER);
-    // H5Pset_dxpl_mpio(plist_id, H5FD_MPIO_COLLECTIVE);   // "set Data Transfer Property List" (x means transfer)
-    plist_id = H5P_DEFAULT;
+    // Create property list for collective dataset read.
+    plist_id = H5Pcreate(H5P_DATASET_XFER);
+#ifdef H5_HAVE_PARALLEL
+    H5Pset_dxpl_mpio(plist_id, H5FD_MPIO_COLLECTIVE); // "set Data Transfer Property List" (x means transfer)
+#endif
 
-    dset_id = H5Dopen2(file_id, ms_datasetname, plist_id);
+    dset_id = H5Dopen2(file_id, ms_datasetname, H5P_DEFAULT);
+    if (dset_id < 0)
+        throw std::runtime_error(string("[ReadMS] Could not open the microstructure dataset ") + ms_datasetname);
 
     hid_t dspace = H5Dget_space(dset_id);
     int   rank   = H5Sget_simple_extent_dims(dspace, _dims, NULL);
@@ -361,13 +449,7 @@ void Reader ::ReadMS(int hm)
 
     if (is_zyx) {
         /* tmp =  [z][y][x] , we need ms = [x][y][z] */
-        for (size_t z = 0; z < dims[2]; ++z)
-            for (size_t y = 0; y < dims[1]; ++y)
-                for (size_t x = 0; x < static_cast<size_t>(local_n0); ++x) {
-                    size_t idx_tmp = (z * dims[1] + y) * local_n0 + x; // z-major
-                    size_t idx_ms  = (x * dims[1] + y) * dims[2] + z;  // x-major
-                    ms[idx_ms]     = tmp[idx_tmp];
-                }
+        transpose_zyx_to_xyz(tmp, ms, local_n0, dims[1], dims[2]);
         FANS_free(tmp);
     } else {
         /* XYZ case: the slab is already in correct order */
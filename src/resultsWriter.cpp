@@ -0,0 +1,267 @@
+#include "general.h"
+#include "resultsWriter.h"
+
+#include "hdf5.h"
+#include "mpi.h"
+
+#include <algorithm>
+#include <limits>
+
+// Target size of the chunks of the time series and upper bound of their chunk cache
+static const hsize_t CHUNK_BYTES = 1 << 20;
+static const hsize_t CACHE_BYTES = 64 << 20;
+
+ResultsWriter::ResultsWriter(const string &file_name, const vector<int> &dims, ptrdiff_t local_n0, ptrdiff_t local_0_start)
+    : file_name(file_name), Nx(dims[0]), Ny(dims[1]), Nz(dims[2])
+{
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    long long local[2] = {local_n0, local_0_start};
+    vector<long long> all(2 * world_size);
+    MPI_Allgather(local, 2, MPI_LONG_LONG, all.data(), 2, MPI_LONG_LONG, MPI_COMM_WORLD);
+    for (int i = 0; i < world_size; ++i) {
+        slab_n0.push_back(all[2 * i]);
+        slab_0_start.push_back(all[2 * i + 1]);
+    }
+
+#ifndef H5_HAVE_PARALLEL
+    // Without MPI-IO rank 0 alone writes
+    if (world_rank != 0)
+        return;
+#endif
+    hid_t plist_id = H5Pcreate(H5P_FILE_ACCESS);
+#ifdef H5_HAVE_PARALLEL
+    H5Pset_fapl_mpio(plist_id, MPI_COMM_WORLD, MPI_INFO_NULL);
+#endif
+
+    /* Save old error handler */
+    herr_t (*old_func)(hid_t, void *);
+    void *old_client_data;
+    H5Eget_auto(H5E_DEFAULT, &old_func, &old_client_data);
+    /* Turn off error handling */
+    H5Eset_auto(H5E_DEFAULT, NULL, NULL);
+
+    file = H5Fopen(file_name.c_str(), H5F_ACC_RDWR, plist_id);
+    /* Restore previous error handler */
+    H5Eset_auto(H5E_DEFAULT, old_func, old_client_data);
+
+    if (file < 0) {
+        file = H5Fcreate(file_name.c_str(), H5F_ACC_EXCL, H5P_DEFAULT, plist_id);
+    }
+    H5Pclose(plist_id);
+    if (file < 0)
+        throw std::runtime_error("Could not open or create the results file " + file_name);
+}
+
+ResultsWriter::~ResultsWriter()
+{
+    Close();
+}
+
+void ResultsWriter::Flush()
+{
+    if (writes())
+        H5Fflush(file, H5F_SCOPE_LOCAL);
+}
+
+void ResultsWriter::Close()
+{
+    if (!writes())
+        return;
+    for (auto &s : series) {
+        H5Dclose(s.second.dset);
+    }
+    series.clear();
+    groups.clear();
+    H5Fclose(file);
+    file = -1;
+}
+
+// Creates the missing groups of the absolute path dset_name, every group is only probed once per run
+void ResultsWriter::create_groups(const string &dset_name)
+{
+    for (size_t pos = dset_name.find('/', 1); pos != string::npos; pos = dset_name.find('/', pos + 1)) {
+        if (dset_name[pos - 1] == '/')
+            continue;
+        const string group = dset_name.substr(0, pos);
+        if (!groups.insert(group).second)
+            continue;
+        if (H5Lexists(file, group.c_str(), H5P_DEFAULT) <= 0) {
+            H5Gclose(H5Gcreate(file, group.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT));
+        }
+    }
+}
+
+static void write_permute_order(hid_t dset)
+{
+    const char perm_str[] = "zyx";
+    hid_t      atype      = H5Tcopy(H5T_C_S1);
+    H5Tset_size(atype, 4); /* 3 chars + '\0' */
+    hid_t aspace = H5Screate(H5S_SCALAR);
+    hid_t attr   = H5Acreate2(dset, "permute_order", atype, aspace, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(attr, atype, perm_str);
+    H5Aclose(attr);
+    H5Sclose(aspace);
+    H5Tclose(atype);
+}
+
+// Opens the field dset_name (global dims Z Y X k) or creates it if it does not exist
+hid_t ResultsWriter::open_field(const string &dset_name, hid_t data_type, int howmany)
+{
+    create_groups(dset_name);
+    if (H5Lexists(file, dset_name.c_str(), H5P_DEFAULT) > 0)
+        return H5Dopen2(file, dset_name.c_str(), H5P_DEFAULT);
+
+    const hsize_t dimsf[4]  = {Nz, Ny, Nx, static_cast<hsize_t>(howmany)};
+    hid_t         filespace = H5Screate_simple(4, dimsf, nullptr);
+    hid_t         dset      = H5Dcreate2(file, dset_name.c_str(), data_type, filespace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    H5Sclose(filespace);
+    if (dset < 0)
+        throw std::runtime_error("ResultsWriter: could not create the dataset " + dset_name);
+    write_permute_order(dset);
+    return dset;
+}
+
+/* ---------------------------------------------------------------------------
+ * Time series with the dimensions {time, step_dims...}. On first use in this
+ * run the dataset is (re)created with n_steps steps and kept open, later
+ * calls only extend it if time_idx or the step dimensions exceed its extent.
+ *
+ * Fields (step_dims = Z Y X k) are chunked as {1, cz, cy, cx, k} with cx the
+ * x-slab of a process, so every chunk is written completely by one process
+ * in one step and never read back. cy and cz grow up to CHUNK_BYTES. The
+ * chunk cache holds the chunks a process writes per step (up to CACHE_BYTES)
+ * and evicts fully written chunks first (w0 = 1).
+ *
+ * Other data is small, its chunks span up to CHUNK_BYTES of time steps, so
+ * the cache holds the whole series and writes it to disk when flushed.
+ * --------------------------------------------------------------------------*/
+hid_t ResultsWriter::open_series(const string &dset_name, hid_t data_type, const vector<hsize_t> &step_dims, hsize_t time_idx, hsize_t n_steps, bool field)
+{
+    auto it = series.find(dset_name);
+    if (it == series.end()) {
+        create_groups(dset_name);
+        // A dataset of an earlier run is replaced
+        if (H5Lexists(file, dset_name.c_str(), H5P_DEFAULT) > 0)
+            H5Ldelete(file, dset_name.c_str(), H5P_DEFAULT);
+
+        const int       rank = step_dims.size() + 1;
+        vector<hsize_t> extent(1, std::max(n_steps, time_idx + 1));
+        extent.insert(extent.end(), step_dims.begin(), step_dims.end());
+        vector<hsize_t> max_extent(rank, H5S_UNLIMITED);
+        vector<hsize_t> chunk(rank);
+
+        const hsize_t type_size   = H5Tget_size(data_type);
+        hsize_t       chunk_bytes = type_size;
+        hsize_t       cache_bytes;
+        if (field) {
+            const hsize_t k  = step_dims[3];
+            const hsize_t cx = std::min<hsize_t>(slab_n0[0], Nx);
+            const hsize_t cy = std::min(std::max<hsize_t>(CHUNK_BYTES / (cx * k * type_size), 1), Ny);
+            const hsize_t cz = cy < Ny ? 1 : std::min(std::max<hsize_t>(CHUNK_BYTES / (cx * Ny * k * type_size), 1), Nz);
+            chunk            = {1, cz, cy, cx, k};
+            std::copy(step_dims.begin(), step_dims.end(), max_extent.begin() + 1);
+
+            const hsize_t chunks_per_step = ((Nz + cz - 1) / cz) * ((Ny + cy - 1) / cy) * ((slab_n0[world_rank] + cx - 1) / cx + 1);
+            chunk_bytes *= cz * cy * cx * k;
+            cache_bytes = std::min(chunks_per_step * chunk_bytes, std::max(CACHE_BYTES, chunk_bytes));
+        } else {
+            hsize_t step_bytes = type_size;
+            for (int i = 1; i < rank; ++i) {
+                chunk[i] = std::max<hsize_t>(step_dims[i - 1], 1);
+                step_bytes *= chunk[i];
+            }
+            // data which grows between the steps (absolute_error) would otherwise get one chunk per entry
+            if (rank > 1 && chunk[rank - 1] < 32) {
+                step_bytes      = step_bytes / chunk[rank - 1] * 32;
+                chunk[rank - 1] = 32;
+            }
+            chunk[0]    = std::min(std::max<hsize_t>(CHUNK_BYTES / step_bytes, 1), extent[0]);
+            chunk_bytes = chunk[0] * step_bytes;
+            cache_bytes = std::max(CHUNK_BYTES, chunk_bytes);
+        }
+
+        hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+        H5Pset_chunk(dcpl, rank, chunk.data());
+        if (H5Tequal(data_type, H5T_NATIVE_DOUBLE) > 0) {
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+            H5Pset_fill_value(dcpl, data_type, &nan);
+        } else if (H5Tequal(data_type, H5T_NATIVE_FLOAT) > 0) {
+            const float nan = std::numeric_limits<float>::quiet_NaN();
+            H5Pset_fill_value(dcpl, data_type, &nan);
+        }
+        if (field) {
+            // The chunks of a field are overwritten completely, steps that were never written read as fill value anyway
+            H5Pset_fill_time(dcpl, H5D_FILL_TIME_NEVER);
+        }
+        hid_t dapl = H5Pcreate(H5P_DATASET_ACCESS);
+        H5Pset_chunk_cache(dapl, 100 * (cache_bytes / chunk_bytes) + 1, cache_bytes, 1.0);
+
+        hid_t filespace = H5Screate_simple(rank, extent.data(), max_extent.data());
+        hid_t dset      = H5Dcreate2(file, dset_name.c_str(), data_type, filespace, H5P_DEFAULT, dcpl, dapl);
+        H5Sclose(filespace);
+        H5Pclose(dapl);
+        H5Pclose(dcpl);
+        if (dset < 0)
+            throw std::runtime_error("ResultsWriter: could not create the dataset " + dset_name);
+        if (field)
+            write_permute_order(dset);
+
+        it = series.emplace(dset_name, Series{dset, extent}).first;
+    }
+
+    // Extend the series if necessary, the time steps beyond the preallocated ones are appended
+    Series &s      = it->second;
+    bool    extend = false;
+    if (time_idx >= s.extent[0]) {
+        s.extent[0] = time_idx + 1;
+        extend      = true;
+    }
+    for (size_t i = 0; i < step_dims.size(); ++i) {
+        if (step_dims[i] > s.extent[i + 1]) {
+            s.extent[i + 1] = step_dims[i];
+            extend          = true;
+        }
+    }
+    if (extend && H5Dset_extent(s.dset, s.extent.data()) < 0)
+        throw std::runtime_error("ResultsWriter: could not extend the dataset " + dset_name);
+    return s.dset;
+}
+
+// Writes the hyperslab offset/count of dset from buf, with MPI-IO collectively (the processes that do not contribute
+// select nothing)
+void ResultsWriter::write_hyperslab(hid_t dset, hid_t data_type, const void *buf, int rank, const hsize_t *offset, const hsize_t *count, bool contribute)
+{
+    hid_t filespace = H5Dget_space(dset);
+    hid_t memspace  = H5Screate_simple(rank, count, nullptr);
+    if (contribute) {
+        H5Sselect_hyperslab(filespace, H5S_SELECT_SET, offset, nullptr, count, nullptr);
+    } else {
+        H5Sselect_none(filespace);
+        H5Sselect_none(memspace);
+    }
+
+    hid_t plist_id = H5Pcreate(H5P_DATASET_XFER);
+#ifdef H5_HAVE_PARALLEL
+    H5Pset_dxpl_mpio(plist_id, H5FD_MPIO_COLLECTIVE);
+#endif
+    herr_t status = H5Dwrite(dset, data_type, memspace, filespace, plist_id, buf);
+    H5Pclose(plist_id);
+    H5Sclose(memspace);
+    H5Sclose(filespace);
+    if (status < 0)
+        throw std::runtime_error("ResultsWriter: H5Dwrite failed");
+}
+
+// Writes the x-planes [x_start, x_start + n_x) of a field (transposed to Z Y X k), optionally into step *time_idx
+void ResultsWriter::write_field(hid_t dset, hid_t data_type, const void *buf, ptrdiff_t x_start, ptrdiff_t n_x, int howmany, const hsize_t *time_idx)
+{
+    const hsize_t offset[5] = {time_idx ? *time_idx : 0, 0, 0, static_cast<hsize_t>(x_start), 0};
+    const hsize_t count[5]  = {1, Nz, Ny, static_cast<hsize_t>(n_x), static_cast<hsize_t>(howmany)};
+    if (time_idx) {
+        write_hyperslab(dset, data_type, buf, 5, offset, count, true);
+    } else {
+        write_hyperslab(dset, data_type, buf, 4, offset + 1, count + 1, true);
+    }
+}
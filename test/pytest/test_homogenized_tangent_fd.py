@@ -0,0 +1,97 @@
+import os
+import numpy as np
+import json
+import pytest
+from fans_dashboard.core.utils import identify_hierarchy, extract_and_organize_data
+
+
+@pytest.fixture(
+    params=[
+        "test_TangentFD_J2Plasticity",
+    ]
+)
+def test_files(request):
+    json_base_dir = os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), "../input_files/"
+    )
+    h5_base_dir = os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), "../../build/test/"
+    )
+
+    json_path = os.path.join(json_base_dir, f"{request.param}.json")
+    h5_path = os.path.join(h5_base_dir, f"{request.param}.h5")
+
+    if os.path.exists(json_path) and os.path.exists(h5_path):
+        return json_path, h5_path
+    pytest.skip(f"Required test files not found: {json_path} or {h5_path}")
+
+
+def test_homogenized_tangent_fd(test_files):
+    """
+    This test verifies the homogenized tangent of a history dependent material model against finite
+    differences of the effective stress. Load case 0 is the reference path, every other load case
+    repeats it with the last time step perturbed in a single strain component. The difference of the
+    effective stresses of the last time step divided by the perturbation has to match the column of
+    the homogenized tangent of load case 0 at the last time step.
+
+    Parameters
+    ----------
+    test_files : tuple
+        A tuple containing (input_json_file, results_h5_file) paths.
+        - input_json_file: Path to the JSON file containing configuration data
+        - results_h5_file: Path to the HDF5 file containing simulation results
+    """
+    input_json_file, results_h5_file = test_files
+
+    with open(input_json_file, "r") as f:
+        input_data = json.load(f)
+    loading = [np.array(load_case) for load_case in input_data["macroscale_loading"]]
+
+    hierarchy = identify_hierarchy(results_h5_file)
+    microstructures_to_load = list(hierarchy.keys())
+    load_cases_to_load = [f"load{i}" for i in range(len(loading))]
+
+    data = extract_and_organize_data(
+        results_h5_file,
+        hierarchy,
+        ["stress_average", "homogenized_tangent"],
+        microstructures_to_load,
+        load_cases_to_load,
+        [],
+    )
+
+    print(f"\nVerifying the homogenized tangent against finite differences...")
+
+    for microstructure in microstructures_to_load:
+        reference = data[microstructure]["load0"]
+        tangent = reference["homogenized_tangent"][-1]
+        tolerance = 5e-3 * np.max(np.abs(tangent))
+
+        for i in range(1, len(loading)):
+            # the load case differs from load case 0 only in one component of the last time step
+            perturbation = loading[i] - loading[0]
+            assert np.all(perturbation[:-1] == 0) and np.count_nonzero(perturbation[-1]) == 1, (
+                f"Load case {i} of {input_json_file} is not load case 0 with a single perturbed "
+                f"component in the last time step"
+            )
+            component = np.flatnonzero(perturbation[-1])[0]
+            h = perturbation[-1][component]
+
+            stress = data[microstructure][f"load{i}"]["stress_average"][-1]
+            finite_difference = (stress - reference["stress_average"][-1]) / h
+
+            assert np.allclose(tangent[:, component], finite_difference, rtol=0.0, atol=tolerance), (
+                f"For microstructure {microstructure}, component {component}: "
+                f"homogenized tangent {tangent[:, component]} differs from the finite difference "
+                f"{finite_difference}, max. difference "
+                f"{np.max(np.abs(tangent[:, component] - finite_difference))}, tolerance {tolerance}"
+            )
+
+            print(
+                f"Verified: {microstructure}, column {component} of the homogenized tangent matches "
+                f"the finite difference of load case {i}"
+            )
+
+
+if __name__ == "__main__":
+    pytest.main(["-v", "-s", __file__])
@@ -13,9 +13,13 @@ from fans_dashboard.core.tensortools import (
 
 @pytest.fixture(
     params=[
+        "test_EyreMilton",
         "test_J2Plasticity",
         "test_LinearElastic",
         "test_LinearThermal",
+        "test_NewtonCG_J2Plasticity",
+        "test_NewtonCG_PseudoPlastic",
+        "test_PipelinedCG",
         "test_PseudoPlastic",
     ]
 )
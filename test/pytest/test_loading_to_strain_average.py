@@ -7,10 +7,15 @@ from fans_dashboard.core.utils import identify_hierarchy, extract_and_organize_d
 
 @pytest.fixture(
     params=[
+        "test_EyreMilton",
         "test_J2Plasticity",
         "test_LinearElastic",
         "test_LinearThermal",
+        "test_NewtonCG_J2Plasticity",
+        "test_NewtonCG_PseudoPlastic",
+        "test_PipelinedCG",
         "test_PseudoPlastic",
+        "test_TangentFD_J2Plasticity",
     ]
 )
 def test_files(request):
@@ -0,0 +1,127 @@
+import os
+import numpy as np
+import json
+import h5py
+import pytest
+
+
+@pytest.fixture(
+    params=[
+        ("test_GreenOnTheFly", "test_LinearElastic", 1e-12),
+        ("test_SinglePrecision", "test_LinearElastic", 1e-6),
+        ("test_MixedPrecision", "test_LinearElastic", 1e-6),
+        ("test_FFTWWisdom", "test_LinearElastic", 1e-12),
+        ("test_PhaseSorted", "test_LinearElastic", 1e-12),
+        ("test_EyreMilton", "test_LinearElastic", 1e-7),
+        ("test_NewtonCG_J2Plasticity", "test_CG_J2Plasticity", 1e-6),
+        ("test_NewtonCG_PseudoPlastic", "test_CG_PseudoPlastic", 1e-6),
+        ("test_ADMM", "test_CG_MixedBCs", 1e-5),
+        ("test_ReferenceBounds", "test_LinearElastic", 1e-12),
+        ("test_ReferenceAdaptive", "test_CG_J2Plasticity", 1e-7),
+        ("test_Predictor", "test_CG_J2Plasticity", 1e-7),
+        ("test_SingleProcess", "test_LinearElastic", 1e-12),
+    ]
+)
+def test_files(request):
+    json_base_dir = os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), "../input_files/"
+    )
+    h5_base_dir = os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), "../../build/test/"
+    )
+
+    case, reference, rtol = request.param
+    paths = []
+    for name in (case, reference):
+        json_path = os.path.join(json_base_dir, f"{name}.json")
+        h5_path = os.path.join(h5_base_dir, f"{name}.h5")
+        if not (os.path.exists(json_path) and os.path.exists(h5_path)):
+            pytest.skip(f"Required test files not found: {json_path} or {h5_path}")
+        paths.extend([json_path, h5_path])
+    return (*paths, rtol)
+
+
+def load_cases(input_data):
+    """The macroscale loading and the predictor of every load case"""
+    predictor = input_data.get("predictor", "none")
+    return [
+        (loading, predictor[i] if isinstance(predictor, list) else predictor)
+        for i, loading in enumerate(input_data["macroscale_loading"])
+    ]
+
+
+def results_group(h5_file, input_data):
+    return h5_file[input_data["microstructure"]["datasetname"].strip("/") + "_results"]
+
+
+def test_results_against_reference(test_files):
+    """
+    This test verifies that a solver, an option of the solver or a number of processes reproduces the
+    results of a reference input of the same problem: the effective stress and strain of every time step
+    have to match within rtol times the largest value of the reference load case. A load case is compared with
+    the reference load case of the same macroscale loading. Load cases that are repeated within the
+    input, with the same predictor, have to give identical results including the convergence history,
+    so nothing but the history of the load case itself affects the results.
+
+    Parameters
+    ----------
+    test_files : tuple
+        A tuple containing (case_json_file, case_h5_file, reference_json_file, reference_h5_file, rtol).
+    """
+    case_json_file, case_h5_file, reference_json_file, reference_h5_file, rtol = test_files
+
+    with open(case_json_file, "r") as f:
+        case_input = json.load(f)
+    with open(reference_json_file, "r") as f:
+        reference_input = json.load(f)
+
+    # Both inputs have to describe the same problem
+    for key in ["microstructure", "problem_type", "matmodel", "material_properties"]:
+        assert case_input[key] == reference_input[key], (
+            f"{case_json_file} and {reference_json_file} differ in {key}"
+        )
+
+    case_loads = load_cases(case_input)
+    reference_loadings = [loading for loading, _ in load_cases(reference_input)]
+
+    with h5py.File(case_h5_file, "r") as fc, h5py.File(reference_h5_file, "r") as fr:
+        case_results = results_group(fc, case_input)
+        reference_results = results_group(fr, reference_input)
+
+        for i, (loading, predictor) in enumerate(case_loads):
+            assert loading in reference_loadings, (
+                f"Load case {i} of {case_json_file} has no counterpart in {reference_json_file}"
+            )
+            j = reference_loadings.index(loading)
+            n_steps = len(loading) if isinstance(loading, list) else len(loading["stress"])
+
+            for quantity in ["stress_average", "strain_average"]:
+                references = [
+                    reference_results[f"load{j}/time_step{t}/{quantity}"][...] for t in range(n_steps)
+                ]
+                atol = rtol * np.max(np.abs(references))
+                for t, reference in enumerate(references):
+                    result = case_results[f"load{i}/time_step{t}/{quantity}"][...]
+                    assert np.allclose(result, reference, rtol=0.0, atol=atol), (
+                        f"{quantity} of load case {i}, time step {t} of {case_h5_file} differs from "
+                        f"load case {j} of {reference_h5_file}, max. difference "
+                        f"{np.max(np.abs(result - reference))}, tolerance {atol}"
+                    )
+
+            # The first load case with the same loading and predictor has to give identical results
+            k = case_loads.index((loading, predictor))
+            if k < i:
+                for t in range(n_steps):
+                    for quantity in ["stress_average", "strain_average", "absolute_error"]:
+                        assert np.array_equal(
+                            case_results[f"load{i}/time_step{t}/{quantity}"][...],
+                            case_results[f"load{k}/time_step{t}/{quantity}"][...],
+                        ), f"{quantity} of the repeated load cases {k} and {i}, time step {t} differ"
+
+            print(
+                f"Verified: load case {i} of {case_h5_file} matches load case {j} of {reference_h5_file}"
+            )
+
+
+if __name__ == "__main__":
+    pytest.main(["-v", "-s", __file__])
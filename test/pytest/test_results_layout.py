@@ -0,0 +1,99 @@
+import os
+import re
+import numpy as np
+import json
+import h5py
+import pytest
+
+
+@pytest.fixture(
+    params=[
+        ("test_TimeSeries", "test_NewtonCG_PseudoPlastic"),
+    ]
+)
+def test_files(request):
+    json_base_dir = os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), "../input_files/"
+    )
+    h5_base_dir = os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), "../../build/test/"
+    )
+
+    paths = []
+    for name in request.param:
+        json_path = os.path.join(json_base_dir, f"{name}.json")
+        h5_path = os.path.join(h5_base_dir, f"{name}.h5")
+        if not (os.path.exists(json_path) and os.path.exists(h5_path)):
+            pytest.skip(f"Required test files not found: {json_path} or {h5_path}")
+        paths.extend([json_path, h5_path])
+    return tuple(paths)
+
+
+def test_results_layout(test_files):
+    """
+    This test verifies that the "time_series" results layout stores the same data as the default
+    "time_steps" layout: step t of every time series equals the dataset of time_step<t>, and the
+    entries of absolute_error beyond the iterations of a time step are NaN.
+
+    Parameters
+    ----------
+    test_files : tuple
+        A tuple containing (series_json_file, series_h5_file, steps_json_file, steps_h5_file) paths
+        of the same problem written with "results_layout": "time_series" and with the default layout.
+    """
+    series_json_file, series_h5_file, steps_json_file, steps_h5_file = test_files
+
+    # Both inputs have to describe the same problem
+    with open(series_json_file, "r") as f:
+        series_input = json.load(f)
+    with open(steps_json_file, "r") as f:
+        steps_input = json.load(f)
+    assert series_input.pop("results_layout") == "time_series"
+    assert steps_input.pop("results_layout", "time_steps") == "time_steps"
+    assert (
+        series_input == steps_input
+    ), f"{series_json_file} and {steps_json_file} differ in more than the results_layout"
+
+    # Time series are the datasets directly below a load<i> group
+    series = []
+
+    def find_series(name, obj):
+        if isinstance(obj, h5py.Dataset) and re.search(r"(^|/)load\d+/[^/]+$", name):
+            series.append(name)
+
+    with h5py.File(series_h5_file, "r") as fs, h5py.File(steps_h5_file, "r") as ft:
+        fs.visititems(find_series)
+        assert series, f"No time series found in {series_h5_file}"
+
+        for name in series:
+            group, quantity = name.rsplit("/", 1)
+            data = fs[name][...]
+
+            n_steps = len([key for key in ft[group].keys() if key.startswith("time_step")])
+            assert data.shape[0] == n_steps, (
+                f"{name} has {data.shape[0]} time steps, "
+                f"{steps_h5_file} has {n_steps} in {group}"
+            )
+
+            for t in range(n_steps):
+                reference = ft[f"{group}/time_step{t}/{quantity}"][...]
+                step = data[t]
+                if reference.shape != step.shape:
+                    # data whose length changes between the time steps is padded with NaN
+                    assert reference.ndim == step.ndim == 1 and reference.shape[0] <= step.shape[0], (
+                        f"Shape of {name} step {t} {step.shape} does not match {reference.shape}"
+                    )
+                    assert np.all(np.isnan(step[reference.shape[0] :])), (
+                        f"{name} step {t} is not padded with NaN"
+                    )
+                    step = step[: reference.shape[0]]
+
+                assert np.allclose(step, reference, rtol=1e-12, atol=0.0), (
+                    f"{name} step {t} differs from {group}/time_step{t}/{quantity}"
+                )
+
+            print(f"Verified: {name} matches {n_steps} time steps of {steps_h5_file}")
+
+
+if __name__ == "__main__":
+    pytest.main(["-v", "-s", __file__])
@@ -21,3 +21,43 @@ $TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_PseudoPlastic.json t
 $TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_J2Plasticity.json test_J2Plasticity.h5 > test_J2Plasticity.log 2>&1
 
 $TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_MixedBCs.json test_MixedBCs.h5 > test_MixedBCs.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_FPAnderson.json test_FPAnderson.h5 > test_FPAnderson.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_NewtonCG_J2Plasticity.json test_NewtonCG_J2Plasticity.h5 > test_NewtonCG_J2Plasticity.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_NewtonCG_PseudoPlastic.json test_NewtonCG_PseudoPlastic.h5 > test_NewtonCG_PseudoPlastic.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_EyreMilton.json test_EyreMilton.h5 > test_EyreMilton.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_ADMM.json test_ADMM.h5 > test_ADMM.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_PipelinedCG.json test_PipelinedCG.h5 > test_PipelinedCG.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_TimeSeries.json test_TimeSeries.h5 > test_TimeSeries.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_TangentFD_J2Plasticity.json test_TangentFD_J2Plasticity.h5 > test_TangentFD_J2Plasticity.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_GreenOnTheFly.json test_GreenOnTheFly.h5 > test_GreenOnTheFly.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_SinglePrecision.json test_SinglePrecision.h5 > test_SinglePrecision.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_MixedPrecision.json test_MixedPrecision.h5 > test_MixedPrecision.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_FFTWWisdom.json test_FFTWWisdom.h5 > test_FFTWWisdom.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_PhaseSorted.json test_PhaseSorted.h5 > test_PhaseSorted.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_CG_J2Plasticity.json test_CG_J2Plasticity.h5 > test_CG_J2Plasticity.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_CG_PseudoPlastic.json test_CG_PseudoPlastic.h5 > test_CG_PseudoPlastic.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_CG_MixedBCs.json test_CG_MixedBCs.h5 > test_CG_MixedBCs.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_ReferenceBounds.json test_ReferenceBounds.h5 > test_ReferenceBounds.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_ReferenceAdaptive.json test_ReferenceAdaptive.h5 > test_ReferenceAdaptive.log 2>&1
+
+$TIME_CMD mpiexec -n $num_processes ./FANS input_files/test_Predictor.json test_Predictor.h5 > test_Predictor.log 2>&1
+
+$TIME_CMD mpiexec -n 1 ./FANS input_files/test_SingleProcess.json test_SingleProcess.h5 > test_SingleProcess.log 2>&1